@@ -0,0 +1,136 @@
+/**
+ * Fragment shader of a post process that draws scene with light shafts
+ * taking as many taps as the ray needs. Short rays near the light take
+ * fewer taps, taps leaving the screen are not taken at all, and the loop
+ * stops when the rest of taps can't change the color any more.
+ * (c) 2014 Damian Nowakowski
+ */
+
+#version 150
+
+/** Texture coords of occlusion image */
+in vec2 inoutTexCoord;
+
+/** Output color of the pixel */
+out vec4 outColor;
+
+/** Position of the light source on screen */
+uniform vec2 lightScreenPos;
+
+/** Intensity of light shafts (0 - only the normal scene, 1 - full light shafts) */
+uniform float intensity;
+
+/** The smallest number of taps of the ray */
+uniform int minSamples;
+
+/** Contribution of the rest of taps (after the weight and exposure) below which the loop stops */
+uniform float epsilon;
+
+/** True to output only the number of taken taps (divided by samples), so they can be counted */
+uniform bool countTaps;
+
+/** Array of textures: 0 - normal scene */
+uniform sampler2DArray tex;
+
+/** Occlusion: how much light passes, the color of the light is given separately */
+uniform sampler2D occlusionTex;
+
+/** Color of the light */
+uniform vec3 lightColor;
+
+/**
+* This is uniform layout storing all needed light shafts parameters.
+* Using this layout application will update the uniform.
+*/
+layout( shared ) uniform ShaftsParams
+{
+    int samples;
+	float exposure;
+	float decay;
+	float density;
+	float weight;
+};
+
+/**
+* Count taps going from the position by -step that stay inside of the screen along one axis.
+*/
+float CountInsideTaps(float position, float step)
+{
+	if (step == 0.0)
+	{
+		return float(samples);
+	}
+	return floor(((step > 0.0) ? position : 1.0 - position) / abs(step));
+}
+
+void main(void)
+{
+	// Set the basic color
+	outColor = vec4(0);
+
+	// Get current texture coordinates.
+	vec2 textCoo = inoutTexCoord.xy;
+
+	/// The longest ray on the screen goes from the light to the furthest corner and takes all samples,
+	/// other rays take a part of them as long as their part of that length (in pixels).
+	vec2 screenSize = vec2(textureSize(occlusionTex, 0));
+	vec2 farthest = max(abs(lightScreenPos), abs(1.0 - lightScreenPos)) * screenSize;
+	float rayLength = length((textCoo - lightScreenPos) * screenSize);
+	int taps = clamp(int(ceil(float(samples) * rayLength / length(farthest))), min(minSamples, samples), samples);
+
+	/// Fewer taps stand for the same part of the ray, so every tap weights as much and
+	/// decays as much as all taps it replaces, which keeps the brightness of the ray.
+	float tapScale = float(samples) / float(taps);
+	float tapWeight = weight * tapScale;
+	float tapDecay = pow(decay, tapScale);
+
+	// Calculate the vector that is a one step on vector from lightsource to
+	// the pixel of image.
+	vec2 deltaTextCoord = textCoo - lightScreenPos;
+	deltaTextCoord *= 1.0 / float(taps) * density;
+
+	// Taps outside of the screen would only read its border again, so the ray ends on it.
+	float insideTaps = min(CountInsideTaps(textCoo.x, deltaTextCoord.x), CountInsideTaps(textCoo.y, deltaTextCoord.y));
+	taps = min(taps, int(insideTaps));
+
+	// Set up illumination decay factor.
+	float illuminationDecay = 1.0;
+
+	// Evaluate the summation of shadows from occlusion texture
+	int taken = 0;
+	for(int i=0; i < taps ; i++)
+	{
+		// The rest of taps sum at most to the geometric series of their decays.
+		if (tapDecay < 1.0 && illuminationDecay * tapWeight * exposure / (1.0 - tapDecay) < epsilon)
+		{
+			break;
+		}
+
+		// Step sample location along ray.
+		textCoo -= deltaTextCoord;
+
+		// Accumulate the sample with attenuation scale/decay factors.
+		outColor.rgb += texture(occlusionTex, textCoo).r * illuminationDecay * tapWeight;
+
+		// Update exponential decay factor.
+		illuminationDecay *= tapDecay;
+		taken++;
+	}
+
+	// When counting output only the number of taps.
+	if (countTaps == true)
+	{
+		outColor = vec4(float(taken) / float(samples));
+		return;
+	}
+
+	// Tint it with the color of the light and output final color with a further scale control factor.
+	outColor.rgb *= lightColor * exposure;
+
+	// Get the avarage of color from calculated light scattering and normal scene.
+	outColor += texture( tex, vec3( inoutTexCoord, 0 ) );
+	outColor *= 0.5;
+
+	// Fade the light shafts out to the normal scene when the light is leaving the view.
+	outColor = texture( tex, vec3( inoutTexCoord, 0 ) ) * (1.0 - intensity) + outColor * intensity;
+}
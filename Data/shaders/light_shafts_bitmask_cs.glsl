@@ -0,0 +1,49 @@
+/**
+ * Compute shader that packs the occlusion into bit masks. Every invocation
+ * reads 32 horizontal texels of the occlusion and stores them as bits of one
+ * texel: x - texels the light passes through (the back light or the marker),
+ * y - texels of the light marker. Hard edged occluders lose nothing, and the
+ * radial blur reads 32 texels with one fetch.
+ * (c) 2014 Damian Nowakowski
+ */
+
+#version 430
+
+layout( local_size_x = 8, local_size_y = 8 ) in;
+
+/** Occlusion packed into bits (x - light passes, y - light marker) */
+layout( rg32ui, binding = 0 ) uniform writeonly uimage2D bitmaskImage;
+
+/** Occlusion: how much light passes */
+uniform sampler2D occlusionTex;
+
+/** Occlusion above which the light passes (between the occluder and the back light) */
+uniform float lightThreshold;
+
+/** Occlusion above which it is the light marker (between the back light and the marker) */
+uniform float markerThreshold;
+
+void main(void)
+{
+	ivec2 word = ivec2(gl_GlobalInvocationID.xy);
+	if (word.x >= imageSize(bitmaskImage).x || word.y >= imageSize(bitmaskImage).y)
+	{
+		return;
+	}
+
+	// Texels after the right edge of the occlusion stay zero, rays are clamped before reaching them.
+	ivec2 size = textureSize(occlusionTex, 0);
+	uvec2 bits = uvec2(0);
+	for (int i = 0; i < 32; i++)
+	{
+		int x = word.x * 32 + i;
+		if (x >= size.x)
+		{
+			break;
+		}
+		float occlusion = texelFetch(occlusionTex, ivec2(x, word.y), 0).r;
+		bits.x |= uint(occlusion > lightThreshold) << i;
+		bits.y |= uint(occlusion > markerThreshold) << i;
+	}
+	imageStore(bitmaskImage, word, uvec4(bits, 0, 0));
+}
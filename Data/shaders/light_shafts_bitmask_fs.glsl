@@ -0,0 +1,106 @@
+/**
+ * Fragment shader of a post process that draws scene with light shafts
+ * calculated from the occlusion packed into bits. One texel of the bit mask
+ * holds 32 horizontal texels of the occlusion, so taps falling into the same
+ * texel as the previous one don't fetch anything and only pick their bit.
+ * (c) 2014 Damian Nowakowski
+ */
+
+#version 150
+
+/** Texture coords of occlusion image */
+in vec2 inoutTexCoord;
+
+/** Output color of the pixel */
+out vec4 outColor;
+
+/** Position of the light source on screen */
+uniform vec2 lightScreenPos;
+
+/** Intensity of light shafts (0 - only the normal scene, 1 - full light shafts) */
+uniform float intensity;
+
+/** Brightness of the back light (the light passing where there is no marker) */
+uniform float backLight;
+
+/** Array of textures: 0 - normal scene */
+uniform sampler2DArray tex;
+
+/** Occlusion packed into bits, 32 horizontal texels in every texel (x - light passes, y - light marker) */
+uniform usampler2D bitmaskTex;
+
+/** Size of the occlusion in texels */
+uniform ivec2 occlusionSize;
+
+/** Color of the light */
+uniform vec3 lightColor;
+
+/**
+* This is uniform layout storing all needed light shafts parameters.
+* Using this layout application will update the uniform.
+*/
+layout( shared ) uniform ShaftsParams
+{
+    int samples;
+	float exposure;
+	float decay;
+	float density;
+	float weight;
+};
+
+void main(void)
+{
+	// Set the basic color
+	outColor = vec4(0);
+
+	// Get current texture coordinates, in texels of the occlusion.
+	vec2 textCoo = inoutTexCoord.xy * vec2(occlusionSize);
+
+	// Calculate the vector that is a one step on vector from lightsource to
+	// the pixel of image.
+	vec2 deltaTextCoord = textCoo - lightScreenPos * vec2(occlusionSize);
+ 	deltaTextCoord *= 1.0 /  float(samples) * density;
+
+	// Set up illumination decay factor.
+	float illuminationDecay = 1.0;
+
+	// Remember the last fetched texel of the bit mask, so the next taps inside of it don't fetch it again.
+	ivec2 word = ivec2(-1);
+	uvec2 bits = uvec2(0);
+
+	// Evaluate the summation of light passing and of the light marker separately.
+	vec2 lightSum = vec2(0);
+	for(int i=0; i < samples ; i++)
+  	{
+		// Step sample location along ray.
+		textCoo -= deltaTextCoord;
+
+		// Fetch the bit mask only when the tap leaves the previous texel of it.
+		ivec2 texel = clamp(ivec2(textCoo), ivec2(0), occlusionSize - 1);
+		ivec2 tapWord = ivec2(texel.x >> 5, texel.y);
+		if (tapWord != word)
+		{
+			word = tapWord;
+			bits = texelFetch(bitmaskTex, word, 0).xy;
+		}
+
+		// Accumulate bits of this tap with the decay.
+		lightSum += vec2((bits >> uint(texel.x & 31)) & uvec2(1)) * illuminationDecay;
+
+		// Update exponential decay factor.
+		illuminationDecay *= decay;
+ 	}
+
+	// The back light passes everywhere the light does, and the marker adds the rest up to the full light.
+	float lightScattering = lightSum.x * backLight + lightSum.y * (1.0 - backLight);
+
+	// Tint it with the color of the light and output final color with a further scale control factor.
+	outColor.rgb = lightColor * lightScattering * weight * exposure;
+
+	// Get the avarage of color from calculated light scattering and normal scene.
+	outColor += texture( tex, vec3( inoutTexCoord, 0 ) );
+	outColor *= 0.5;
+
+	// Fade the light shafts out to the normal scene when the light is leaving the view.
+	outColor = texture( tex, vec3( inoutTexCoord, 0 ) ) * (1.0 - intensity) + outColor * intensity;
+}
@@ -0,0 +1,171 @@
+/**
+ * Compute shader that calculates the light scattering (the same radial blur
+ * as the fragment shader) for a tile of pixels at once. Rays of all pixels
+ * of the tile go through a wedge pointing at the light. The wedge is loaded
+ * into shared memory once (rows - directions, columns - distances from the
+ * light) and then all rays of the tile are summed from it, so neighbour
+ * pixels don't fetch the same occlusion again and again.
+ * (c) 2014 Damian Nowakowski
+ */
+
+#version 430
+
+/** Size of the tile of pixels calculated by one work group */
+#define TILE_SIZE 16
+
+/** Number of directions and distances of the wedge stored in shared memory */
+#define WEDGE_ANGLES 24
+#define WEDGE_RADII 160
+
+layout( local_size_x = TILE_SIZE, local_size_y = TILE_SIZE ) in;
+
+/** Output light scattering (rgb - light scattering, a - linear depth of the scene) */
+layout( rgba16f, binding = 0 ) uniform writeonly image2D scatterImage;
+
+/** Position of the light source on screen */
+uniform vec2 lightScreenPos;
+
+/** Size of the screen in pixels */
+uniform vec2 screenSize;
+
+/** Near and far plane of the camera (for depth linearization) */
+uniform vec2 clipPlanes;
+
+/** Occlusion: how much light passes, the color of the light is given separately */
+uniform sampler2D occlusionTex;
+
+/** Color of the light */
+uniform vec3 lightColor;
+
+/** Array of depth textures: 0 - normal scene */
+uniform sampler2DArray depthTex;
+
+/**
+* This is uniform layout storing all needed light shafts parameters.
+* Using this layout application will update the uniform.
+*/
+layout( shared ) uniform ShaftsParams
+{
+    int samples;
+	float exposure;
+	float decay;
+	float density;
+	float weight;
+};
+
+/** Occlusion of the wedge (a single channel, so it takes half of the packed colors it used to) */
+shared float wedge[WEDGE_ANGLES * WEDGE_RADII];
+
+const float PI = 3.1415927;
+
+/**
+* Get the occlusion from the wedge at the given (not integer) row and column.
+*/
+float SampleWedge(float row, float column)
+{
+	int r = int(row);
+	int c = int(column);
+	vec2 fraction = vec2(row - float(r), column - float(c));
+	int r1 = min(r + 1, WEDGE_ANGLES - 1);
+	int c1 = min(c + 1, WEDGE_RADII - 1);
+
+	float top = mix(wedge[r * WEDGE_RADII + c], wedge[r * WEDGE_RADII + c1], fraction.y);
+	float bottom = mix(wedge[r1 * WEDGE_RADII + c], wedge[r1 * WEDGE_RADII + c1], fraction.y);
+	return mix(top, bottom, fraction.x);
+}
+
+void main(void)
+{
+	ivec2 size = imageSize(scatterImage);
+	ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+	vec2 textCoo = (vec2(pixel) + 0.5) / vec2(size);
+
+	// Everything about the wedge is measured in screen pixels, relatively to the light.
+	vec2 lightPos = lightScreenPos * screenSize;
+	vec2 pixelScale = screenSize / vec2(size);
+	vec2 tileMin = (vec2(gl_WorkGroupID.xy * TILE_SIZE) + 0.5) * pixelScale - lightPos;
+	vec2 tileMax = (vec2(min(ivec2(gl_WorkGroupID.xy * TILE_SIZE) + TILE_SIZE, size) - 1) + 0.5) * pixelScale - lightPos;
+
+	/// Rays of the tile go from its pixels to (1 - density) of the way to the light. The closest
+	/// point of the tile gives the nearest distance of the wedge and the farthest corner the last one.
+	/// When the light is close to the tile the wedge would cover almost every direction,
+	/// so such tiles sample the occlusion texture directly (the same for the whole work group).
+	float tileDistance = length(max(max(tileMin, -tileMax), vec2(0)));
+	bool direct = tileDistance < float(TILE_SIZE) * max(pixelScale.x, pixelScale.y);
+	vec2 corners[4] = vec2[4](tileMin, vec2(tileMax.x, tileMin.y), vec2(tileMin.x, tileMax.y), tileMax);
+	float baseAngle = atan(corners[0].y, corners[0].x);
+	vec2 angleRange = vec2(0);
+	float maxDistance = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		float angle = atan(corners[i].y, corners[i].x) - baseAngle;
+		angle -= 2.0 * PI * round(angle / (2.0 * PI));
+		angleRange = vec2(min(angleRange.x, angle), max(angleRange.y, angle));
+		maxDistance = max(maxDistance, length(corners[i]));
+	}
+	angleRange = vec2(baseAngle + angleRange.x, max(angleRange.y - angleRange.x, 1e-4));
+	vec2 radiusRange = vec2(tileDistance * (1.0 - density), 0);
+	radiusRange.y = max(maxDistance - radiusRange.x, 1e-4);
+
+	/// Load the wedge cooperatively, every invocation loads a few of its texels.
+	if (direct == false)
+	{
+		for (int i = int(gl_LocalInvocationIndex); i < WEDGE_ANGLES * WEDGE_RADII; i += TILE_SIZE * TILE_SIZE)
+		{
+			float angle = angleRange.x + angleRange.y * (float(i / WEDGE_RADII) + 0.5) / float(WEDGE_ANGLES);
+			float distance = radiusRange.x + radiusRange.y * (float(i % WEDGE_RADII) + 0.5) / float(WEDGE_RADII);
+			vec2 sampleCoo = (lightPos + vec2(cos(angle), sin(angle)) * distance) / screenSize;
+			wedge[i] = texture(occlusionTex, clamp(sampleCoo,0,1)).r;
+		}
+	}
+	barrier();
+
+	// Invocations outside of the image were needed only for loading.
+	if (pixel.x >= size.x || pixel.y >= size.y)
+	{
+		return;
+	}
+
+	// Remember the linear depth of the scene pixel under this texel. It will guide the upsampling.
+	ivec2 depthCoord = ivec2(textCoo * vec2(textureSize(depthTex, 0).xy));
+	float depth = texelFetch(depthTex, ivec3(depthCoord, 0), 0).r;
+	vec4 outColor = vec4(0, 0, 0, clipPlanes.x * clipPlanes.y / (clipPlanes.y - depth * (clipPlanes.y - clipPlanes.x)));
+
+	// Set up illumination decay factor.
+	float illuminationDecay = 1.0;
+
+	if (direct == true)
+	{
+		// Exactly the same summation as in the fragment shader.
+		vec2 deltaTextCoord = textCoo - lightScreenPos;
+		deltaTextCoord *= 1.0 /  float(samples) * density;
+		for(int i=0; i < samples ; i++)
+		{
+			textCoo -= deltaTextCoord;
+			outColor.rgb += texture(occlusionTex, clamp(textCoo,0,1)).r * illuminationDecay * weight;
+			illuminationDecay *= decay;
+		}
+	}
+	else
+	{
+		// The ray of this pixel keeps its direction, so it goes along one (not integer) row of the wedge.
+		vec2 toPixel = textCoo * screenSize - lightPos;
+		float angle = atan(toPixel.y, toPixel.x) - angleRange.x;
+		angle -= 2.0 * PI * round(angle / (2.0 * PI));
+		float row = clamp(angle / angleRange.y * float(WEDGE_ANGLES) - 0.5, 0.0, float(WEDGE_ANGLES - 1));
+
+		// Step through columns of the wedge the same way the original steps to the light.
+		float column = (length(toPixel) - radiusRange.x) / radiusRange.y * float(WEDGE_RADII) - 0.5;
+		float deltaColumn = length(toPixel) * density / float(samples) / radiusRange.y * float(WEDGE_RADII);
+		for(int i=0; i < samples ; i++)
+		{
+			column -= deltaColumn;
+			outColor.rgb += SampleWedge(row, clamp(column, 0.0, float(WEDGE_RADII - 1))) * illuminationDecay * weight;
+			illuminationDecay *= decay;
+		}
+	}
+
+	// Tint it with the color of the light and output final color with a further scale control factor.
+	outColor.rgb *= lightColor * exposure;
+	imageStore(scatterImage, pixel, outColor);
+}
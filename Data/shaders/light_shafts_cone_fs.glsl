@@ -0,0 +1,94 @@
+/**
+ * Fragment shader of a post process that draws scene with light shafts
+ * calculated with few taps. Taps are further from each other the further
+ * they are from the pixel, and every tap reads the mip level of the occlusion
+ * as coarse as the part of the ray it stands for, so it sums it at once.
+ * (c) 2014 Damian Nowakowski
+ */
+
+#version 150
+
+/** Texture coords of occlusion image */
+in vec2 inoutTexCoord;
+
+/** Output color of the pixel */
+out vec4 outColor;
+
+/** Position of the light source on screen */
+uniform vec2 lightScreenPos;
+
+/** Intensity of light shafts (0 - only the normal scene, 1 - full light shafts) */
+uniform float intensity;
+
+/** Number of taps calculated instead of samples */
+uniform int coneSamples;
+
+/** Bias added to the mip level of every tap */
+uniform float lodBias;
+
+/** Array of textures: 0 - normal scene */
+uniform sampler2DArray tex;
+
+/** Occlusion: how much light passes (with mipmaps), the color of the light is given separately */
+uniform sampler2D occlusionTex;
+
+/** Color of the light */
+uniform vec3 lightColor;
+
+/**
+* This is uniform layout storing all needed light shafts parameters.
+* Using this layout application will update the uniform.
+*/
+layout( shared ) uniform ShaftsParams
+{
+    int samples;
+	float exposure;
+	float decay;
+	float density;
+	float weight;
+};
+
+void main(void)
+{
+	// Set the basic color
+	outColor = vec4(0);
+
+	// The vector from the pixel to the end of the ray and its length in texels of the occlusion.
+	vec2 ray = (inoutTexCoord - lightScreenPos) * density;
+	float rayTexels = length(ray * vec2(textureSize(occlusionTex, 0)));
+
+	/// Tap k stands for the part of the ray between (k / coneSamples)^2 and ((k + 1) / coneSamples)^2,
+	/// so parts get longer away from the pixel, where the decay makes the shadows less important.
+	/// Sample i of the radial blur is at (i + 1) / samples of the ray with weight decay^i, so the weight
+	/// of the tap is the geometric sum of decays of all samples inside its part of the ray.
+	float rayStart = 0.0;
+	for (int k = 0; k < coneSamples; k++)
+	{
+		float rayEnd = float(k + 1) / float(coneSamples);
+		rayEnd *= rayEnd;
+
+		float firstSample = rayStart * float(samples);
+		float lastSample = rayEnd * float(samples);
+		float tapDecay = decay < 1.0 ? (pow(decay, firstSample) - pow(decay, lastSample)) / (1.0 - decay) : lastSample - firstSample;
+
+		// Read the mip level where one texel is as long as this part of the ray.
+		float lod = log2(max((rayEnd - rayStart) * rayTexels, 1.0)) + lodBias;
+		vec2 textCoo = inoutTexCoord - ray * (rayStart + rayEnd) * 0.5;
+		float occlusionSample = textureLod(occlusionTex, clamp(textCoo,0,1), lod).r;
+
+		// Accumulate combined color.
+		outColor.rgb += occlusionSample * tapDecay * weight;
+
+		rayStart = rayEnd;
+	}
+
+	// Tint it with the color of the light and output final color with a further scale control factor.
+	outColor.rgb *= lightColor * exposure;
+
+	// Get the avarage of color from calculated light scattering and normal scene.
+	outColor += texture( tex, vec3( inoutTexCoord, 0 ) );
+	outColor *= 0.5;
+
+	// Fade the light shafts out to the normal scene when the light is leaving the view.
+	outColor = texture( tex, vec3( inoutTexCoord, 0 ) ) * (1.0 - intensity) + outColor * intensity;
+}
@@ -0,0 +1,50 @@
+/**
+ * Fragment shader of a post process that blurs the light scattering in one
+ * direction (it is run twice: horizontally and vertically). Texels with the
+ * depth different from the center one lose their weight, so the noise is
+ * removed without blurring the light scattering through silhouettes.
+ * (c) 2014 Damian Nowakowski
+ */
+
+#version 150
+
+/** Texture coords of occlusion image */
+in vec2 inoutTexCoord;
+
+/** Output color of the pixel (rgb - light scattering, a - linear depth of the scene) */
+out vec4 outColor;
+
+/** Step between texels of the blur in texture coordinates */
+uniform vec2 direction;
+
+/** Number of texels taken on each side of the center one */
+uniform int radius;
+
+/** Relative depth difference at which the texel loses most of its weight */
+uniform float depthSigma;
+
+/** Light scattering to blur (rgb - light scattering, a - linear depth of the scene) */
+uniform sampler2D scatterTex;
+
+void main(void)
+{
+	vec4 center = texture(scatterTex, inoutTexCoord);
+
+	// Gaussian weights fall to a few percents at the radius.
+	float sigma = max(float(radius) * 0.5, 0.5);
+	vec4 color = vec4(center.rgb, 1);
+	for (int i = -radius; i <= radius; i++)
+	{
+		if (i == 0)
+		{
+			continue;
+		}
+		vec4 texel = texture(scatterTex, inoutTexCoord + direction * float(i));
+		float depthDifference = (texel.a - center.a) / (depthSigma * center.a);
+		float texelWeight = exp(-0.5 * float(i * i) / (sigma * sigma) - depthDifference * depthDifference);
+		color += vec4(texel.rgb, 1) * texelWeight;
+	}
+
+	// Keep the depth of the center, the next passes need it too.
+	outColor = vec4(color.rgb / color.a, center.a);
+}
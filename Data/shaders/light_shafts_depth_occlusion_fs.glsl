@@ -0,0 +1,59 @@
+/**
+ * Fragment shader that makes the occlusion from the depth of the normal scene
+ * instead of drawing the scene again. Texels of the sky (on the far plane)
+ * let the back light pass, texels of the geometry are occluded, and discs of
+ * light markers are added where they are in front of the geometry.
+ * (c) 2014 Damian Nowakowski
+ */
+
+#version 150
+
+/** The maximum number of light markers (must be the same as SHAFTS_MAX_LIGHTS in the application) */
+#define MAX_LIGHTS 64
+
+/** Texture coords of occlusion image */
+in vec2 inoutTexCoord;
+
+/** Output occlusion: how much light passes */
+out vec4 outColor;
+
+/** Array of depth textures: 0 - normal scene */
+uniform sampler2DArray depthTex;
+
+/** Light passing through the sky (the back light) */
+uniform float skyLight;
+
+/** Light passing through markers */
+uniform float markerLight;
+
+/** Number of light markers */
+uniform int markerCount;
+
+/** Discs of light markers on screen (xy - center, zw - radius) in (0,1) coordinates */
+uniform vec4 markers[MAX_LIGHTS];
+
+/** Depths of light markers (the same as in the depth texture) */
+uniform float markerDepths[MAX_LIGHTS];
+
+void main(void)
+{
+	// The exact pixel is fetched, because the filtered depth would blur the silhouettes.
+	ivec2 size = textureSize(depthTex, 0).xy;
+	ivec2 texel = min(ivec2(inoutTexCoord * vec2(size)), size - 1);
+	float depth = texelFetch(depthTex, ivec3(texel, 0), 0).r;
+
+	// Nothing was drawn on the far plane, so it is the sky.
+	float occlusion = (depth >= 1.0) ? skyLight : 0.0;
+
+	// Markers pass the depth test like when they were drawn.
+	for (int i = 0; i < markerCount; i++)
+	{
+		vec2 offset = (inoutTexCoord - markers[i].xy) / markers[i].zw;
+		if (dot(offset, offset) <= 1.0 && markerDepths[i] < depth)
+		{
+			occlusion = markerLight;
+		}
+	}
+
+	outColor = vec4(occlusion, 0, 0, 1);
+}
@@ -0,0 +1,188 @@
+/**
+ * Fragment shader of a post process that draws scene with light shafts
+ * interpolated from the epipolar lines. When the pixel lies on a depth
+ * discontinuity that the lines can't represent the light shafts are
+ * calculated for this pixel directly.
+ * (c) 2014 Damian Nowakowski
+ */
+
+#version 150
+
+/** Texture coords of occlusion image */
+in vec2 inoutTexCoord;
+
+/** Output color of the pixel */
+out vec4 outColor;
+
+/** Position of the light source on screen */
+uniform vec2 lightScreenPos;
+
+/** Size of the screen in pixels */
+uniform vec2 screenSize;
+
+/** Angle of the first epipolar line and the angle covered by all lines */
+uniform vec2 angleRange;
+
+/** Near and far plane of the camera (for depth linearization) */
+uniform vec2 clipPlanes;
+
+/** Number of epipolar lines and number of samples on every line */
+uniform ivec2 epipolarSize;
+
+/** Maximum relative depth difference that still allows the interpolation */
+uniform float depthThreshold;
+
+/** True when lines are covering the full circle around the light */
+uniform bool wrapLines;
+
+/** Intensity of light shafts (0 - only the normal scene, 1 - full light shafts) */
+uniform float intensity;
+
+/** Array of textures: 0 - normal scene */
+uniform sampler2DArray tex;
+
+/** Occlusion: how much light passes, the color of the light is given separately */
+uniform sampler2D occlusionTex;
+
+/** Color of the light */
+uniform vec3 lightColor;
+
+/** Array of depth textures: 0 - normal scene */
+uniform sampler2DArray depthTex;
+
+/** Light shafts calculated along epipolar lines (rgb - color, a - linear depth) */
+uniform sampler2D epipolarTex;
+
+/**
+* This is uniform layout storing all needed light shafts parameters.
+* Using this layout application will update the uniform.
+*/
+layout( shared ) uniform ShaftsParams
+{
+    int samples;
+	float exposure;
+	float decay;
+	float density;
+	float weight;
+};
+
+const float PI = 3.1415927;
+
+/**
+* Find where the ray from the light source in the given direction enters
+* and leaves the screen. Everything is in pixels.
+* @returns x - distance of the entry point, y - distance of the exit point.
+*/
+vec2 ClipRayToScreen(vec2 origin, vec2 dir)
+{
+	// Avoid dividing by zero for axis aligned rays
+	vec2 safeDir = mix(dir, vec2(1e-6), lessThan(abs(dir), vec2(1e-6)));
+	vec2 t0 = (vec2(0) - origin) / safeDir;
+	vec2 t1 = (screenSize - origin) / safeDir;
+	vec2 tMin = min(t0, t1);
+	vec2 tMax = max(t0, t1);
+	return vec2(max(max(tMin.x, tMin.y), 0.0), min(tMax.x, tMax.y));
+}
+
+/**
+* Calculate light shafts for the given texture coordinates the same way
+* the full screen light shafts shader does it.
+*/
+vec3 CalculateLightShafts(vec2 textCoo)
+{
+	vec3 color = vec3(0);
+
+	// Calculate the vector that is a one step on vector from lightsource to
+	// the pixel of image.
+	vec2 deltaTextCoord = textCoo - lightScreenPos;
+ 	deltaTextCoord *= 1.0 /  float(samples) * density;
+
+	// Set up illumination decay factor.
+	float illuminationDecay = 1.0;
+
+	// Evaluate the summation of shadows from occlusion texture
+	for(int i=0; i < samples ; i++)
+  	{
+		textCoo -= deltaTextCoord;
+		color += texture(occlusionTex, clamp(textCoo,0,1)).r * illuminationDecay * weight;
+		illuminationDecay *= decay;
+ 	}
+
+	return color * lightColor * exposure;
+}
+
+void main(void)
+{
+	// Get the linear depth of this pixel
+	float depth = texture(depthTex, vec3(inoutTexCoord, 0)).r;
+	float linearDepth = clipPlanes.x * clipPlanes.y / (clipPlanes.y - depth * (clipPlanes.y - clipPlanes.x));
+
+	// Find the direction and the distance from the light to this pixel.
+	vec2 lightPos = lightScreenPos * screenSize;
+	vec2 toPixel = inoutTexCoord * screenSize - lightPos;
+	float distance = length(toPixel);
+
+	// Find the (not integer) epipolar line this pixel lies on.
+	// Angle is measured from the first line, so there is no jump between -PI and PI.
+	float angle = mod(atan(toPixel.y, toPixel.x) - angleRange.x, 2.0 * PI);
+	float line = angle / angleRange.y * float(epipolarSize.y) - 0.5;
+	int firstLine = int(floor(line));
+	float lineFraction = line - float(firstLine);
+
+	/// Interpolate the light shafts from four samples on the two closest lines.
+	/// Samples with a depth too different from the pixel depth are rejected.
+	vec4 color = vec4(0);
+	for (int l = 0; l < 2; l++)
+	{
+		// Get the line and wrap it around or clamp it to the existing ones.
+		int lineIndex = firstLine + l;
+		if (wrapLines == true)
+		{
+			lineIndex = (lineIndex + epipolarSize.y) % epipolarSize.y;
+		}
+		else
+		{
+			lineIndex = clamp(lineIndex, 0, epipolarSize.y - 1);
+		}
+
+		// Find the position of this pixel on that line.
+		float lineAngle = angleRange.x + angleRange.y * (float(lineIndex) + 0.5) / float(epipolarSize.y);
+		vec2 segment = ClipRayToScreen(lightPos, vec2(cos(lineAngle), sin(lineAngle)));
+		if (segment.y <= segment.x)
+		{
+			continue;
+		}
+		float position = clamp((distance - segment.x) / (segment.y - segment.x), 0.0, 1.0) * float(epipolarSize.x - 1);
+		int firstSample = min(int(position), epipolarSize.x - 2);
+		float sampleFraction = position - float(firstSample);
+
+		for (int s = 0; s < 2; s++)
+		{
+			vec4 epipolarSample = texelFetch(epipolarTex, ivec2(firstSample + s, lineIndex), 0);
+			float sampleWeight = (l == 0 ? 1.0 - lineFraction : lineFraction) * (s == 0 ? 1.0 - sampleFraction : sampleFraction);
+			if (abs(epipolarSample.a - linearDepth) > depthThreshold * linearDepth)
+			{
+				sampleWeight = 0.0;
+			}
+			color += vec4(epipolarSample.rgb, 1) * sampleWeight;
+		}
+	}
+
+	// Use the interpolated light shafts if there were any valid samples.
+	// Otherwise this pixel lies on the depth discontinuity and must be refined.
+	if (color.a > 0.001)
+	{
+		outColor = vec4(color.rgb / color.a, 0);
+	}
+	else
+	{
+		outColor = vec4(CalculateLightShafts(inoutTexCoord), 0);
+	}
+
+	// Get the avarage of color from calculated light scattering and normal scene.
+	outColor += texture( tex, vec3( inoutTexCoord, 0 ) );
+	outColor *= 0.5;
+
+	// Fade the light shafts out to the normal scene when the light is leaving the view.
+	outColor = texture( tex, vec3( inoutTexCoord, 0 ) ) * (1.0 - intensity) + outColor * intensity;
+}
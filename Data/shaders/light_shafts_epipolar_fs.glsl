@@ -0,0 +1,124 @@
+/**
+ * Fragment shader of a post process that calculates light shafts only along
+ * epipolar lines (lines going from the light source to the screen border).
+ * Every texel of the output is one sample on one line:
+ * x - sample on the line, y - the line.
+ * (c) 2014 Damian Nowakowski
+ */
+
+#version 150
+
+/** Output color of the sample (rgb - light scattering, a - linear depth of the scene) */
+out vec4 outColor;
+
+/** Position of the light source on screen */
+uniform vec2 lightScreenPos;
+
+/** Size of the screen in pixels */
+uniform vec2 screenSize;
+
+/** Angle of the first epipolar line and the angle covered by all lines */
+uniform vec2 angleRange;
+
+/** Near and far plane of the camera (for depth linearization) */
+uniform vec2 clipPlanes;
+
+/** Number of epipolar lines and number of samples on every line */
+uniform ivec2 epipolarSize;
+
+/** Occlusion: how much light passes, the color of the light is given separately */
+uniform sampler2D occlusionTex;
+
+/** Color of the light */
+uniform vec3 lightColor;
+
+/** Array of depth textures: 0 - normal scene */
+uniform sampler2DArray depthTex;
+
+/**
+* This is uniform layout storing all needed light shafts parameters.
+* Using this layout application will update the uniform.
+*/
+layout( shared ) uniform ShaftsParams
+{
+    int samples;
+	float exposure;
+	float decay;
+	float density;
+	float weight;
+};
+
+/**
+* Find where the ray from the light source in the given direction enters
+* and leaves the screen. Everything is in pixels.
+* @returns x - distance of the entry point, y - distance of the exit point.
+*/
+vec2 ClipRayToScreen(vec2 origin, vec2 dir)
+{
+	// Avoid dividing by zero for axis aligned rays
+	vec2 safeDir = mix(dir, vec2(1e-6), lessThan(abs(dir), vec2(1e-6)));
+	vec2 t0 = (vec2(0) - origin) / safeDir;
+	vec2 t1 = (screenSize - origin) / safeDir;
+	vec2 tMin = min(t0, t1);
+	vec2 tMax = max(t0, t1);
+	return vec2(max(max(tMin.x, tMin.y), 0.0), min(tMax.x, tMax.y));
+}
+
+void main(void)
+{
+	// Set the basic color
+	outColor = vec4(0);
+
+	// Find the direction of the line this texel belongs to
+	ivec2 sampleCoord = ivec2(gl_FragCoord.xy);
+	float angle = angleRange.x + angleRange.y * (float(sampleCoord.y) + 0.5) / float(epipolarSize.y);
+	vec2 dir = vec2(cos(angle), sin(angle));
+
+	// Find the visible part of the line, lines that don't cross the screen stay black.
+	vec2 lightPos = lightScreenPos * screenSize;
+	vec2 segment = ClipRayToScreen(lightPos, dir);
+	if (segment.y <= segment.x)
+	{
+		return;
+	}
+
+	// Get the texture coordinates of this sample on the line.
+	float t = float(sampleCoord.x) / float(epipolarSize.x - 1);
+	vec2 textCoo = (lightPos + dir * mix(segment.x, segment.y, t)) / screenSize;
+
+	// Remember the linear depth of the scene under this sample. It will be used
+	// to detect depth discontinuities during the interpolation.
+	float depth = texture(depthTex, vec3(textCoo, 0)).r;
+	outColor.a = clipPlanes.x * clipPlanes.y / (clipPlanes.y - depth * (clipPlanes.y - clipPlanes.x));
+
+	// From here everything is exactly the same as in the full screen light shafts.
+	// Calculate the vector that is a one step on vector from lightsource to
+	// the pixel of image.
+	vec2 deltaTextCoord = textCoo - lightScreenPos;
+ 	deltaTextCoord *= 1.0 /  float(samples) * density;
+
+	// Set up illumination decay factor.
+	float illuminationDecay = 1.0;
+
+	// Evaluate the summation of shadows from occlusion texture
+	for(int i=0; i < samples ; i++)
+  	{
+		// Step sample location along ray.
+		textCoo -= deltaTextCoord;
+
+		// Retrieve sample at new location.
+		float occlusionSample = texture(occlusionTex, clamp(textCoo,0,1)).r;
+
+		// Apply sample attenuation scale/decay factors.
+		occlusionSample *= illuminationDecay * weight;
+
+		// Accumulate combined color.
+		outColor.rgb += occlusionSample;
+
+		// Update exponential decay factor.
+		illuminationDecay *= decay;
+ 	}
+
+	// Tint it with the color of the light and output final color with a further scale control factor.
+	outColor.rgb *= lightColor * exposure;
+}
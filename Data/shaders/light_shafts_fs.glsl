@@ -14,21 +14,20 @@ out vec4 outColor;
 /** Position of the light source on screen */
 uniform vec2 lightScreenPos;
 
-/** Array of textures: 0 - occlusion scene, 1 - normal scene */
+/** Intensity of light shafts (0 - only the normal scene, 1 - full light shafts) */
+uniform float intensity;
+
+/** Array of textures: 0 - normal scene */
 uniform sampler2DArray tex;
 
-/**
-* This is uniform layout storing all needed light shafts parameters.
-* Using this layout application will update the uniform.
-*/
-layout( shared ) uniform ShaftsParams
-{
-    int samples;
-	float exposure;
-	float decay;
-	float density;
-	float weight;
-};
+/** Occlusion: how much light passes, the color of the light is given separately */
+uniform sampler2D occlusionTex;
+
+/** Color of the light */
+uniform vec3 lightColor;
+
+/** Light shafts parameters */
+#include "light_shafts_params.glsl"
 
 void main(void)
 {
@@ -41,34 +40,37 @@ void main(void)
 	// Calculate the vector that is a one step on vector from lightsource to
 	// the pixel of image.
 	vec2 deltaTextCoord = textCoo - lightScreenPos;
- 	deltaTextCoord *= 1.0 /  float(samples) * density;
+ 	deltaTextCoord *= 1.0 /  float(SHAFTS_SAMPLES) * density;
  	
 	// Set up illumination decay factor.
 	float illuminationDecay = 1.0;
 
 	// Evaluate the summation of shadows from occlusion texture
-	for(int i=0; i < samples ; i++)
+	for(int i=0; i < SHAFTS_SAMPLES ; i++)
   	{
 		// Step sample location along ray.
 		textCoo -= deltaTextCoord;
 
 		// Retrieve sample at new location.  
-		vec4 colorSample  = texture(tex, vec3( clamp(textCoo,0,1), 0 ) );
+		float occlusionSample = texture(occlusionTex, clamp(textCoo,0,1)).r;
 			
 		// Apply sample attenuation scale/decay factors.
-		colorSample  *= illuminationDecay * weight;
+		occlusionSample *= illuminationDecay * weight;
 
 		// Accumulate combined color.  
-		outColor += colorSample;
+		outColor.rgb += occlusionSample;
 
 		// Update exponential decay factor.
 		illuminationDecay *= decay;
  	}
 
-	// Output final color with a further scale control factor.
-	outColor *= exposure;
+	// Tint it with the color of the light and output final color with a further scale control factor.
+	outColor.rgb *= lightColor * exposure;
 
 	// Get the avarage of color from calculated light scattering and normal scene.	
-	outColor += texture( tex, vec3( inoutTexCoord, 1 ) );
+	outColor += texture( tex, vec3( inoutTexCoord, 0 ) );
 	outColor *= 0.5;
+
+	// Fade the light shafts out to the normal scene when the light is leaving the view.
+	outColor = texture( tex, vec3( inoutTexCoord, 0 ) ) * (1.0 - intensity) + outColor * intensity;
 }
\ No newline at end of file
@@ -0,0 +1,87 @@
+/**
+ * Fragment shader of a post process that calculates one pass of the
+ * hierarchical radial blur. Every pass takes only a few taps, but each pass
+ * steps further than the previous one, so all passes together cover as many
+ * taps as the product of taps of every pass.
+ * (c) 2014 Damian Nowakowski
+ */
+
+#version 150
+
+/** Texture coords of occlusion image */
+in vec2 inoutTexCoord;
+
+/** Output color of the pixel (rgb - light scattering, a - linear depth of the scene) */
+out vec4 outColor;
+
+/** Position of the light source on screen */
+uniform vec2 lightScreenPos;
+
+/** Near and far plane of the camera (for depth linearization) */
+uniform vec2 clipPlanes;
+
+/** Number of taps in this pass */
+uniform int taps;
+
+/** Logarithm of the distance scale between two taps of this pass */
+uniform float passScale;
+
+/** Distance (in the same units as scale) of the first tap from the pixel */
+uniform float passOffset;
+
+/** Decay between two taps of this pass */
+uniform float passDecay;
+
+/** Weight of the whole pass (the last pass applies weight and exposure) */
+uniform float passWeight;
+
+/** True when this is the first pass, which reads the occlusion instead of the previous pass */
+uniform bool firstPass;
+
+/** Occlusion: how much light passes, the color of the light is given separately */
+uniform sampler2D occlusionTex;
+
+/** Color of the light */
+uniform vec3 lightColor;
+
+/** Array of depth textures: 0 - normal scene */
+uniform sampler2DArray depthTex;
+
+/** Result of the previous pass */
+uniform sampler2D previousPassTex;
+
+void main(void)
+{
+	// Set the basic color
+	outColor = vec4(0);
+
+	// Remember the linear depth of the scene pixel under this texel. It will guide the upsampling.
+	ivec2 depthCoord = ivec2(inoutTexCoord * vec2(textureSize(depthTex, 0).xy));
+	float depth = texelFetch(depthTex, ivec3(depthCoord, 0), 0).r;
+	outColor.a = clipPlanes.x * clipPlanes.y / (clipPlanes.y - depth * (clipPlanes.y - clipPlanes.x));
+
+	// Vector from the light source to the pixel. Taps are scaling it down towards the light.
+	vec2 lightToPixel = inoutTexCoord - lightScreenPos;
+
+	// Set up illumination decay factor.
+	float illuminationDecay = 1.0;
+
+	// Evaluate the summation of shadows from occlusion texture or from the previous pass
+	for(int i=0; i < taps ; i++)
+	{
+		// Tap location is scaled exponentially, so scales of all passes multiply into each other.
+		vec2 textCoo = clamp(lightScreenPos + lightToPixel * exp(-passScale * float(i) - passOffset), 0, 1);
+
+		// Retrieve sample at new location (the occlusion is tinted with the color of the light).
+		vec3 colorSample = (firstPass == true) ? lightColor * texture(occlusionTex, textCoo).r : texture(previousPassTex, textCoo).rgb;
+
+		// Accumulate decayed sample.
+		outColor.rgb += colorSample * illuminationDecay;
+
+		// Update exponential decay factor.
+		illuminationDecay *= passDecay;
+	}
+
+	// Output final color with a further scale control factor.
+	outColor.rgb *= passWeight;
+}
@@ -0,0 +1,61 @@
+/**
+ * Fragment shader that builds one level of the min/max pyramid of the occlusion.
+ * The first level stores the range of the 2x2 texels a filtered tap between them
+ * reads, so it bounds every tap whose filter starts at this texel. Every next
+ * level stores the range of 2x2 texels of the previous one (3 on odd edges).
+ * (c) 2014 Damian Nowakowski
+ */
+
+#version 150
+
+/** Output range of the occlusion (r - minimum, g - maximum) */
+out vec4 outColor;
+
+/** True when the first level is built from the occlusion */
+uniform bool firstLevel;
+
+/** Occlusion: how much light passes */
+uniform sampler2D occlusionTex;
+
+/** Min/max pyramid with only the previous level available */
+uniform sampler2D minMaxTex;
+
+void main(void)
+{
+	ivec2 texel = ivec2(gl_FragCoord.xy);
+	vec2 range = vec2(1e10, -1e10);
+
+	if (firstLevel == true)
+	{
+		// Filtered taps read this texel and the next ones (clamped to the edge like the texture is).
+		ivec2 size = textureSize(occlusionTex, 0);
+		for (int y = 0; y < 2; y++)
+		{
+			for (int x = 0; x < 2; x++)
+			{
+				float occlusion = texelFetch(occlusionTex, min(texel + ivec2(x, y), size - 1), 0).r;
+				range = vec2(min(range.x, occlusion), max(range.y, occlusion));
+			}
+		}
+	}
+	else
+	{
+		// The last texel of the level also covers the last texel of the odd previous level.
+		ivec2 size = textureSize(minMaxTex, 0);
+		ivec2 levelSize = max(size / 2, ivec2(1));
+		ivec2 first = texel * 2;
+		ivec2 last = min(first + 1, size - 1);
+		if (texel.x == levelSize.x - 1)		last.x = size.x - 1;
+		if (texel.y == levelSize.y - 1)		last.y = size.y - 1;
+		for (int y = first.y; y <= last.y; y++)
+		{
+			for (int x = first.x; x <= last.x; x++)
+			{
+				vec2 previous = texelFetch(minMaxTex, ivec2(x, y), 0).rg;
+				range = vec2(min(range.x, previous.x), max(range.y, previous.y));
+			}
+		}
+	}
+
+	outColor = vec4(range, 0, 1);
+}
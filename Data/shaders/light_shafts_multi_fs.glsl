@@ -0,0 +1,123 @@
+/**
+ * Fragment shader of a post process that calculates only the light scattering
+ * of many lights in one pass. All lights share the occlusion of the scene, every
+ * light takes its own radial blur of it with its own marker disc added, and tints
+ * it with its color. Lights take less taps than the radial blur, jittered with
+ * blue noise and denoised after that.
+ * (c) 2014 Damian Nowakowski
+ */
+
+#version 150
+
+/** Maximum number of lights (the same as SHAFTS_MAX_LIGHTS in application) */
+#define MAX_LIGHTS 64
+
+/** Texture coords of occlusion image */
+in vec2 inoutTexCoord;
+
+/** Output color of the pixel (rgb - light scattering, a - linear depth of the scene) */
+out vec4 outColor;
+
+/** Near and far plane of the camera (for depth linearization) */
+uniform vec2 clipPlanes;
+
+/** True when the start of every ray is moved by the blue noise */
+uniform bool jitter;
+
+/** Occlusion of the scene without markers: how much light passes, every light tints it with its own color */
+uniform sampler2D occlusionTex;
+
+/** Array of depth textures: 0 - normal scene */
+uniform sampler2DArray depthTex;
+
+/** Tiled blue noise in (0,1) range */
+uniform sampler2D noiseTex;
+
+/**
+* This is uniform layout storing all needed light shafts parameters.
+* Using this layout application will update the uniform.
+*/
+layout( shared ) uniform ShaftsParams
+{
+    int samples;
+	float exposure;
+	float decay;
+	float density;
+	float weight;
+};
+
+/**
+* This is uniform layout storing all lights that are not culled.
+* Only first lightCount elements of arrays are valid.
+*/
+layout( std140 ) uniform ShaftsLights
+{
+	vec4 lightPositions[MAX_LIGHTS];	// xy - position of the light source on screen
+	vec4 lightColors[MAX_LIGHTS];		// rgb - color of the light scaled by its intensity
+	vec4 lightMarkers[MAX_LIGHTS];		// xy - radius of the marker disc on screen, z - depth of the marker
+	int lightCount;
+	int lightSamples;
+};
+
+void main(void)
+{
+	// Set the basic color
+	outColor = vec4(0);
+
+	// Remember the linear depth of the scene pixel under this texel. It will guide the denoise and the upsampling.
+	ivec2 depthSize = textureSize(depthTex, 0).xy;
+	ivec2 depthCoord = ivec2(inoutTexCoord * vec2(depthSize));
+	float depth = texelFetch(depthTex, ivec3(depthCoord, 0), 0).r;
+	outColor.a = clipPlanes.x * clipPlanes.y / (clipPlanes.y - depth * (clipPlanes.y - clipPlanes.x));
+
+	// Every tap stands for (samples / lightSamples) taps of the full radial blur,
+	// so its decay and weight are scaled to keep the same falloff and intensity.
+	float tapScale = float(samples) / float(lightSamples);
+	float tapDecay = pow(decay, tapScale);
+
+	// Without jitter every ray starts one step from the pixel, like in the radial blur.
+	float noise = jitter ? texelFetch(noiseTex, ivec2(gl_FragCoord.xy) % textureSize(noiseTex, 0), 0).r : 1.0;
+
+	for (int light = 0; light < lightCount; light++)
+	{
+		// Calculate the vector that is a one step on vector from this light to the pixel of image.
+		vec2 textCoo = inoutTexCoord.xy;
+		vec2 deltaTextCoord = textCoo - lightPositions[light].xy;
+		deltaTextCoord *= 1.0 / float(lightSamples) * density;
+
+		// Every light moves its rays by a different part of the step, so their noise doesn't add up.
+		float offset = jitter ? fract(noise + float(light) * 0.618034) : 1.0;
+		textCoo -= deltaTextCoord * offset;
+		float illuminationDecay = pow(tapDecay, offset - 1.0);
+
+		// Evaluate the summation of shadows from occlusion texture
+		float lightScattering = 0.0;
+		for (int i = 0; i < lightSamples; i++)
+		{
+			vec2 tapCoo = clamp(textCoo,0,1);
+			float occlusionSample = texture(occlusionTex, tapCoo).r;
+
+			// Only the marker of this light is its source. It is white where it passes the depth test,
+			// like the marker drawn into the occlusion of the single light.
+			vec2 markerOffset = (tapCoo - lightPositions[light].xy) / lightMarkers[light].xy;
+			if (dot(markerOffset, markerOffset) <= 1.0)
+			{
+				ivec2 tapTexel = min(ivec2(tapCoo * vec2(depthSize)), depthSize - 1);
+				if (lightMarkers[light].z < texelFetch(depthTex, ivec3(tapTexel, 0), 0).r)
+				{
+					occlusionSample = 1.0;
+				}
+			}
+
+			lightScattering += occlusionSample * illuminationDecay;
+			textCoo -= deltaTextCoord;
+			illuminationDecay *= tapDecay;
+		}
+
+		// Tint the light scattering with the color of this light.
+		outColor.rgb += lightScattering * lightColors[light].rgb;
+	}
+
+	// Output final color with a further scale control factor.
+	outColor.rgb *= weight * tapScale * exposure;
+}
@@ -0,0 +1,95 @@
+/**
+ * Fragment shader of a post process that calculates only the light scattering
+ * with a small number of taps. The start of every ray is moved by the value
+ * of tiled blue noise, so neighbour pixels take taps at different places and
+ * the banding of few taps turns into the noise removed by the denoise pass.
+ * (c) 2014 Damian Nowakowski
+ */
+
+#version 150
+
+/** Texture coords of occlusion image */
+in vec2 inoutTexCoord;
+
+/** Output color of the pixel (rgb - light scattering, a - linear depth of the scene) */
+out vec4 outColor;
+
+/** Position of the light source on screen */
+uniform vec2 lightScreenPos;
+
+/** Near and far plane of the camera (for depth linearization) */
+uniform vec2 clipPlanes;
+
+/** Number of taps calculated instead of samples */
+uniform int noiseSamples;
+
+/** Number of taps, constant when the program is specialized */
+#ifdef NOISE_SAMPLES
+#define SHAFTS_NOISE_SAMPLES NOISE_SAMPLES
+#else
+#define SHAFTS_NOISE_SAMPLES noiseSamples
+#endif
+
+/** Occlusion: how much light passes, the color of the light is given separately */
+uniform sampler2D occlusionTex;
+
+/** Color of the light */
+uniform vec3 lightColor;
+
+/** Array of depth textures: 0 - normal scene */
+uniform sampler2DArray depthTex;
+
+/** Tiled blue noise in (0,1) range */
+uniform sampler2D noiseTex;
+
+/** Light shafts parameters */
+#include "light_shafts_params.glsl"
+
+void main(void)
+{
+	// Set the basic color
+	outColor = vec4(0);
+
+	// Get current texture coordinates.
+	vec2 textCoo = inoutTexCoord.xy;
+
+	// Remember the linear depth of the scene pixel under this texel. It will guide the denoise and the upsampling.
+	ivec2 depthCoord = ivec2(textCoo * vec2(textureSize(depthTex, 0).xy));
+	float depth = texelFetch(depthTex, ivec3(depthCoord, 0), 0).r;
+	outColor.a = clipPlanes.x * clipPlanes.y / (clipPlanes.y - depth * (clipPlanes.y - clipPlanes.x));
+
+	// Calculate the vector that is a one step on vector from lightsource to
+	// the pixel of image. Steps are longer, because there are less of them.
+	vec2 deltaTextCoord = textCoo - lightScreenPos;
+ 	deltaTextCoord *= 1.0 /  float(SHAFTS_NOISE_SAMPLES) * density;
+
+	// Every tap stands for (samples / noiseSamples) taps of the full radial blur,
+	// so its decay and weight are scaled to keep the same falloff and intensity.
+	float tapScale = float(SHAFTS_SAMPLES) / float(SHAFTS_NOISE_SAMPLES);
+	float tapDecay = pow(decay, tapScale);
+
+	// Move the start of the ray by the part of the step taken from the blue noise.
+	float offset = texelFetch(noiseTex, ivec2(gl_FragCoord.xy) % textureSize(noiseTex, 0), 0).r;
+	textCoo -= deltaTextCoord * offset;
+	float illuminationDecay = pow(tapDecay, offset - 1.0);
+
+	// Evaluate the summation of shadows from occlusion texture
+	for(int i=0; i < SHAFTS_NOISE_SAMPLES ; i++)
+  	{
+		// Retrieve sample at current location.
+		float occlusionSample = texture(occlusionTex, clamp(textCoo,0,1)).r;
+
+		// Apply sample attenuation scale/decay factors.
+		occlusionSample *= illuminationDecay * weight * tapScale;
+
+		// Accumulate combined color.
+		outColor.rgb += occlusionSample;
+
+		// Step sample location along ray and update exponential decay factor.
+		textCoo -= deltaTextCoord;
+		illuminationDecay *= tapDecay;
+ 	}
+
+	// Tint it with the color of the light and output final color with a further scale control factor.
+	outColor.rgb *= lightColor * exposure;
+}
@@ -0,0 +1,26 @@
+/**
+ * Light shafts parameters shared by the radial blur shaders. The program
+ * can be specialized with SAMPLES (and NOISE_SAMPLES) defined, so loops take
+ * constant numbers of taps the compiler can unroll and fold.
+ * (c) 2014 Damian Nowakowski
+ */
+
+/**
+* This is uniform layout storing all needed light shafts parameters.
+* Using this layout application will update the uniform.
+*/
+layout( shared ) uniform ShaftsParams
+{
+    int samples;
+	float exposure;
+	float decay;
+	float density;
+	float weight;
+};
+
+/** Number of taps of the ray, constant when the program is specialized */
+#ifdef SAMPLES
+#define SHAFTS_SAMPLES SAMPLES
+#else
+#define SHAFTS_SAMPLES samples
+#endif
@@ -0,0 +1,56 @@
+/**
+ * Compute shader that runs the radial blur over the occlusion warped into
+ * polar coordinates. In polar space the blur goes along rows, so it can be
+ * calculated as a recursive exponential filter: every texel only adds its
+ * own occlusion to the decayed sum of the previous one and removes the
+ * occlusion that has just left the blur window. The cost doesn't depend
+ * on the number of samples.
+ * (c) 2014 Damian Nowakowski
+ */
+
+#version 430
+
+/** Every invocation scans one row (one direction from the light) */
+layout( local_size_x = 64 ) in;
+
+/** Occlusion warped into polar coordinates */
+layout( rgba16f, binding = 0 ) uniform readonly image2D polarImage;
+
+/** Light scattering in polar coordinates */
+layout( rgba16f, binding = 1 ) uniform writeonly image2D scanImage;
+
+/** Decay of the sum between two neighbour texels */
+uniform float tapDecay;
+
+/** Weight of the occlusion of every texel */
+uniform float tapWeight;
+
+/** Number of texels covered by the blur window */
+uniform int windowLength;
+
+/** Decay of the texel that leaves the blur window (tapDecay ^ windowLength) */
+uniform float windowDecay;
+
+void main(void)
+{
+	int row = int(gl_GlobalInvocationID.x);
+	ivec2 size = imageSize(polarImage);
+	if (row >= size.y)
+	{
+		return;
+	}
+
+	// Go from the light outside and keep the sum of all decayed texels in the window.
+	vec3 sum = vec3(0);
+	for (int i = 0; i < size.x; i++)
+	{
+		sum = sum * tapDecay + imageLoad(polarImage, ivec2(i, row)).rgb * tapWeight;
+		if (i >= windowLength)
+		{
+			sum -= imageLoad(polarImage, ivec2(i - windowLength, row)).rgb * tapWeight * windowDecay;
+		}
+
+		// Rounding errors of removing texels could go slightly below zero.
+		imageStore(scanImage, ivec2(i, row), vec4(max(sum, vec3(0)), 0));
+	}
+}
@@ -0,0 +1,53 @@
+/**
+ * Fragment shader that warps the light scattering calculated in polar
+ * coordinates back to the screen.
+ * (c) 2014 Damian Nowakowski
+ */
+
+#version 150
+
+/** Texture coords of occlusion image */
+in vec2 inoutTexCoord;
+
+/** Output color of the pixel (rgb - light scattering, a - linear depth of the scene) */
+out vec4 outColor;
+
+/** Position of the light source on screen */
+uniform vec2 lightScreenPos;
+
+/** Size of the screen in pixels */
+uniform vec2 screenSize;
+
+/** Angle of the first row and the angle covered by all rows */
+uniform vec2 angleRange;
+
+/** Logarithm of the distance (in pixels) of the first column and the range covered by all columns */
+uniform vec2 radiusRange;
+
+/** Near and far plane of the camera (for depth linearization) */
+uniform vec2 clipPlanes;
+
+/** Array of depth textures: 0 - normal scene */
+uniform sampler2DArray depthTex;
+
+/** Light scattering in polar coordinates */
+uniform sampler2D polarTex;
+
+const float PI = 3.1415927;
+
+void main(void)
+{
+	// Remember the linear depth of the scene pixel under this texel. It will guide the upsampling.
+	ivec2 depthCoord = ivec2(inoutTexCoord * vec2(textureSize(depthTex, 0).xy));
+	float depth = texelFetch(depthTex, ivec3(depthCoord, 0), 0).r;
+	float linearDepth = clipPlanes.x * clipPlanes.y / (clipPlanes.y - depth * (clipPlanes.y - clipPlanes.x));
+
+	// Find the direction and the distance from the light to this pixel.
+	vec2 toPixel = (inoutTexCoord - lightScreenPos) * screenSize;
+	float angle = mod(atan(toPixel.y, toPixel.x) - angleRange.x, 2.0 * PI);
+	float distance = log(max(length(toPixel), 1e-3));
+
+	// Read the light scattering at this direction and distance.
+	vec2 polarCoord = vec2((distance - radiusRange.x) / radiusRange.y, angle / angleRange.y);
+	outColor = vec4(texture(polarTex, polarCoord).rgb, linearDepth);
+}
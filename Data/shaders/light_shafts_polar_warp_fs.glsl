@@ -0,0 +1,45 @@
+/**
+ * Fragment shader that warps the occlusion into polar coordinates around
+ * the light source. Every row of the output is one direction from the light
+ * and every column is one distance from it. Distances grow logarithmically,
+ * so the radial blur becomes the same filter for every distance.
+ * (c) 2014 Damian Nowakowski
+ */
+
+#version 150
+
+/** Output color of the occlusion in polar coordinates */
+out vec4 outColor;
+
+/** Position of the light source on screen */
+uniform vec2 lightScreenPos;
+
+/** Size of the screen in pixels */
+uniform vec2 screenSize;
+
+/** Angle of the first row and the angle covered by all rows */
+uniform vec2 angleRange;
+
+/** Logarithm of the distance (in pixels) of the first column and the range covered by all columns */
+uniform vec2 radiusRange;
+
+/** Number of distances (columns) and directions (rows) of the polar texture */
+uniform ivec2 polarSize;
+
+/** Occlusion: how much light passes, the color of the light is given separately */
+uniform sampler2D occlusionTex;
+
+/** Color of the light */
+uniform vec3 lightColor;
+
+void main(void)
+{
+	// Find the direction and the distance from the light this texel represents.
+	vec2 polarCoord = gl_FragCoord.xy / vec2(polarSize);
+	float angle = angleRange.x + angleRange.y * polarCoord.y;
+	float distance = exp(radiusRange.x + radiusRange.y * polarCoord.x);
+
+	// Get the occlusion at this place (clamped to the screen like in the radial blur) tinted with the color of the light.
+	vec2 textCoo = lightScreenPos + vec2(cos(angle), sin(angle)) * distance / screenSize;
+	outColor = vec4(lightColor * texture(occlusionTex, clamp(textCoo,0,1)).r, 1.0);
+}
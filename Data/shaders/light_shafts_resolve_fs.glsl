@@ -0,0 +1,38 @@
+/**
+ * Fragment shader of a post process that copies the final scene rendered
+ * in higher precision to the screen. With dithering the noise of the size
+ * of one step of the 8-bit screen is added before it is rounded, so smooth
+ * gradients of light shafts don't turn into bands.
+ * (c) 2014 Damian Nowakowski
+ */
+
+#version 150
+
+/** Texture coords of the final scene */
+in vec2 inoutTexCoord;
+
+/** Output color of the pixel */
+out vec4 outColor;
+
+/** True to dither the color before it is rounded to the screen */
+uniform bool dither;
+
+/** Final scene in higher precision than the screen */
+uniform sampler2D resolveTex;
+
+/** Tiled blue noise in (0,1) range */
+uniform sampler2D noiseTex;
+
+void main(void)
+{
+	outColor = texture(resolveTex, inoutTexCoord);
+
+	if (dither == true)
+	{
+		// Turn the blue noise into the triangular noise of two steps width, which hides bands
+		// without making the noise depend on the color.
+		float noise = texelFetch(noiseTex, ivec2(gl_FragCoord.xy) % textureSize(noiseTex, 0), 0).r * 2.0 - 1.0;
+		noise = sign(noise) * (1.0 - sqrt(1.0 - abs(noise)));
+		outColor.rgb += noise / 255.0;
+	}
+}
@@ -0,0 +1,77 @@
+/**
+ * Fragment shader of a post process that calculates only the light scattering
+ * (without composing it with the scene). It is used to render light shafts
+ * into a texture of lower resolution than the screen.
+ * (c) 2014 Damian Nowakowski
+ */
+
+#version 150
+
+/** Texture coords of occlusion image */
+in vec2 inoutTexCoord;
+
+/** Output color of the pixel (rgb - light scattering, a - linear depth of the scene) */
+out vec4 outColor;
+
+/** Position of the light source on screen */
+uniform vec2 lightScreenPos;
+
+/** Near and far plane of the camera (for depth linearization) */
+uniform vec2 clipPlanes;
+
+/** Occlusion: how much light passes, the color of the light is given separately */
+uniform sampler2D occlusionTex;
+
+/** Color of the light */
+uniform vec3 lightColor;
+
+/** Array of depth textures: 0 - normal scene */
+uniform sampler2DArray depthTex;
+
+/** Light shafts parameters */
+#include "light_shafts_params.glsl"
+
+void main(void)
+{
+	// Set the basic color
+	outColor = vec4(0);
+
+	// Get current texture coordinates.
+	vec2 textCoo = inoutTexCoord.xy;
+
+	// Remember the linear depth of the scene pixel under this texel. It will guide the upsampling.
+	// The exact pixel is fetched, because the filtered depth would blur the silhouettes.
+	ivec2 depthCoord = ivec2(textCoo * vec2(textureSize(depthTex, 0).xy));
+	float depth = texelFetch(depthTex, ivec3(depthCoord, 0), 0).r;
+	outColor.a = clipPlanes.x * clipPlanes.y / (clipPlanes.y - depth * (clipPlanes.y - clipPlanes.x));
+
+	// Calculate the vector that is a one step on vector from lightsource to
+	// the pixel of image.
+	vec2 deltaTextCoord = textCoo - lightScreenPos;
+ 	deltaTextCoord *= 1.0 /  float(SHAFTS_SAMPLES) * density;
+
+	// Set up illumination decay factor.
+	float illuminationDecay = 1.0;
+
+	// Evaluate the summation of shadows from occlusion texture
+	for(int i=0; i < SHAFTS_SAMPLES ; i++)
+  	{
+		// Step sample location along ray.
+		textCoo -= deltaTextCoord;
+
+		// Retrieve sample at new location.
+		float occlusionSample = texture(occlusionTex, clamp(textCoo,0,1)).r;
+
+		// Apply sample attenuation scale/decay factors.
+		occlusionSample *= illuminationDecay * weight;
+
+		// Accumulate combined color.
+		outColor.rgb += occlusionSample;
+
+		// Update exponential decay factor.
+		illuminationDecay *= decay;
+ 	}
+
+	// Tint it with the color of the light and output final color with a further scale control factor.
+	outColor.rgb *= lightColor * exposure;
+}
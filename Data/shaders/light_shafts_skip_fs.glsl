@@ -0,0 +1,182 @@
+/**
+ * Fragment shader of a post process that draws scene with light shafts
+ * calculated with empty space skipping. The min/max pyramid of the occlusion
+ * tells where the occlusion doesn't change, and all taps of the ray inside
+ * such a place are summed at once with the geometric sum of their decays.
+ * Only taps near the edges of the occlusion are taken one by one.
+ * (c) 2014 Damian Nowakowski
+ */
+
+#version 150
+
+/** Occlusion range below which it is treated as uniform */
+#define UNIFORM_RANGE 1e-4
+
+/** Difference from the brute force loop (after the weight and exposure) that is still correct */
+#define VALIDATE_TOLERANCE 0.002
+
+/** Texture coords of occlusion image */
+in vec2 inoutTexCoord;
+
+/** Output color of the pixel */
+out vec4 outColor;
+
+/** Position of the light source on screen */
+uniform vec2 lightScreenPos;
+
+/** Intensity of light shafts (0 - only the normal scene, 1 - full light shafts) */
+uniform float intensity;
+
+/** Highest level of the min/max pyramid */
+uniform int maxLevel;
+
+/** True to compare with the brute force loop, pixels that match it are discarded */
+uniform bool validate;
+
+/** Array of textures: 0 - normal scene */
+uniform sampler2DArray tex;
+
+/** Occlusion: how much light passes, the color of the light is given separately */
+uniform sampler2D occlusionTex;
+
+/** Min/max pyramid of the occlusion (r - minimum, g - maximum) */
+uniform sampler2D minMaxTex;
+
+/** Color of the light */
+uniform vec3 lightColor;
+
+/**
+* This is uniform layout storing all needed light shafts parameters.
+* Using this layout application will update the uniform.
+*/
+layout( shared ) uniform ShaftsParams
+{
+    int samples;
+	float exposure;
+	float decay;
+	float density;
+	float weight;
+};
+
+/**
+* Sum the decayed occlusion along the ray tap by tap, exactly as the full screen light shafts do it.
+*/
+float SumTaps(vec2 textCoo, vec2 deltaTextCoord)
+{
+	float sum = 0.0;
+	float illuminationDecay = 1.0;
+	for(int i=0; i < samples ; i++)
+  	{
+		textCoo -= deltaTextCoord;
+		sum += texture(occlusionTex, clamp(textCoo,0,1)).r * illuminationDecay;
+		illuminationDecay *= decay;
+ 	}
+	return sum;
+}
+
+/**
+* Count taps that stay on the inner side of the bound along one axis. Taps go from the position
+* by -step, the bound is below them when the step is positive and above them otherwise.
+*/
+float CountTaps(float position, float step, float lowBound, float highBound)
+{
+	if (step == 0.0)
+	{
+		return float(samples);
+	}
+	float distance = (step > 0.0) ? (position - lowBound) / step : (highBound - position) / -step;
+	return floor(distance - 1e-4) + 1.0;
+}
+
+/**
+* Sum the decayed occlusion along the ray, skipping places where it doesn't change.
+*/
+float SumTapsSkipping(vec2 textCoo, vec2 deltaTextCoord)
+{
+	vec2 size = vec2(textureSize(occlusionTex, 0));
+	vec2 step = deltaTextCoord * size;
+	float sum = 0.0;
+	float illuminationDecay = 1.0;
+	int level = 0;
+	int i = 0;
+	while (i < samples)
+	{
+		// Positions are calculated from the pixel, so they don't drift after big jumps.
+		vec2 tapCoo = textCoo - deltaTextCoord * float(i + 1);
+		bool onScreen = tapCoo == clamp(tapCoo, 0.0, 1.0);
+		if (onScreen == true)
+		{
+			/// The filtered tap reads the texels from floor(p - 0.5), which is the texel of the first level
+			/// bounding it. The last texel of every level covers the rest of the odd level below it.
+			vec2 position = tapCoo * size;
+			ivec2 levelSize = textureSize(minMaxTex, level);
+			ivec2 node = min(clamp(ivec2(floor(position - 0.5)), ivec2(0), ivec2(size) - 1) >> level, levelSize - 1);
+			vec2 range = texelFetch(minMaxTex, node, level).rg;
+			if (range.y - range.x <= UNIFORM_RANGE)
+			{
+				// Bounds of positions whose taps start in texels of this node (edge texels take the clamped taps too).
+				vec2 lowBound = mix(vec2(node << level) + 0.5, vec2(0), equal(node, ivec2(0)));
+				vec2 highBound = mix(vec2((node + 1) << level) + 0.5, size, equal(node, levelSize - 1));
+				float taps = min(CountTaps(position.x, step.x, lowBound.x, highBound.x), CountTaps(position.y, step.y, lowBound.y, highBound.y));
+				int count = clamp(int(taps), 1, samples - i);
+
+				// All taps read the same occlusion, so their decays make the geometric series.
+				float series = (decay < 1.0) ? (1.0 - pow(decay, float(count))) / (1.0 - decay) : float(count);
+				sum += range.x * illuminationDecay * series;
+				illuminationDecay *= pow(decay, float(count));
+				i += count;
+
+				// Try the bigger node with the next tap.
+				level = min(level + 1, maxLevel);
+				continue;
+			}
+			else if (level > 0)
+			{
+				// The node is not uniform, try the smaller one.
+				level--;
+				continue;
+			}
+		}
+
+		// Near edges (and outside of the screen) the tap is taken like in the brute force loop.
+		sum += texture(occlusionTex, clamp(tapCoo,0,1)).r * illuminationDecay;
+		illuminationDecay *= decay;
+		i++;
+	}
+	return sum;
+}
+
+void main(void)
+{
+	// Set the basic color
+	outColor = vec4(0);
+
+	// Calculate the vector that is a one step on vector from lightsource to
+	// the pixel of image.
+	vec2 deltaTextCoord = inoutTexCoord - lightScreenPos;
+ 	deltaTextCoord *= 1.0 /  float(samples) * density;
+
+	float lightScattering = SumTapsSkipping(inoutTexCoord, deltaTextCoord);
+
+	// When validating show only pixels that differ from the brute force loop, so they can be counted.
+	if (validate == true)
+	{
+		float difference = abs(lightScattering - SumTaps(inoutTexCoord, deltaTextCoord)) * weight * exposure;
+		if (difference <= VALIDATE_TOLERANCE)
+		{
+			discard;
+		}
+		outColor = vec4(1, 0, 0, 1);
+		return;
+	}
+
+	// Tint it with the color of the light and output final color with a further scale control factor.
+	outColor.rgb = lightColor * lightScattering * weight * exposure;
+
+	// Get the avarage of color from calculated light scattering and normal scene.
+	outColor += texture( tex, vec3( inoutTexCoord, 0 ) );
+	outColor *= 0.5;
+
+	// Fade the light shafts out to the normal scene when the light is leaving the view.
+	outColor = texture( tex, vec3( inoutTexCoord, 0 ) ) * (1.0 - intensity) + outColor * intensity;
+}
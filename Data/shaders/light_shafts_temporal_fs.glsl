@@ -0,0 +1,131 @@
+/**
+ * Fragment shader of a post process that calculates only a part of light
+ * scattering taps every frame (every tapStride-th tap starting from tapOffset)
+ * and accumulates them with the history of previous frames. The history is
+ * reprojected with the previous camera, so after a few frames it converges
+ * to the same light scattering as with all taps calculated.
+ * (c) 2014 Damian Nowakowski
+ */
+
+#version 330
+
+/** Texture coords of occlusion image */
+in vec2 inoutTexCoord;
+
+/** Output color of the pixel (rgb - accumulated light scattering, a - linear depth of the scene) */
+layout( location = 0 ) out vec4 outColor;
+
+/** Number of frames accumulated in the history of this pixel */
+layout( location = 1 ) out float outAge;
+
+/** Position of the light source on screen */
+uniform vec2 lightScreenPos;
+
+/** Near and far plane of the camera (for depth linearization) */
+uniform vec2 clipPlanes;
+
+/** First tap calculated in this frame and the step between calculated taps */
+uniform int tapOffset;
+uniform int tapStride;
+
+/** Inverse of the current view projection matrix of the camera */
+uniform mat4 inverseViewProjection;
+
+/** View projection matrix of the camera in the previous frame */
+uniform mat4 previousViewProjection;
+
+/** Maximum number of frames the history can stand for */
+uniform float maxAge;
+
+/** Maximum relative depth difference of the history that is still the same surface (0 - don't check) */
+uniform float historyDepthThreshold;
+
+/** True when the whole history must be dropped */
+uniform bool resetHistory;
+
+/** Occlusion: how much light passes, the color of the light is given separately */
+uniform sampler2D occlusionTex;
+
+/** Color of the light */
+uniform vec3 lightColor;
+
+/** Array of depth textures: 0 - normal scene */
+uniform sampler2DArray depthTex;
+
+/** Light scattering of the previous frame (rgb - light scattering, a - linear depth of the scene) */
+uniform sampler2D previousPassTex;
+
+/** Number of frames accumulated in the previous frame */
+uniform sampler2D historyAgeTex;
+
+/**
+* This is uniform layout storing all needed light shafts parameters.
+* Using this layout application will update the uniform.
+*/
+layout( shared ) uniform ShaftsParams
+{
+    int samples;
+	float exposure;
+	float decay;
+	float density;
+	float weight;
+};
+
+void main(void)
+{
+	// Get current texture coordinates.
+	vec2 textCoo = inoutTexCoord.xy;
+
+	// Remember the linear depth of the scene pixel under this texel. It will guide the upsampling
+	// and tell if the history belongs to the same surface.
+	ivec2 depthCoord = ivec2(textCoo * vec2(textureSize(depthTex, 0).xy));
+	float depth = texelFetch(depthTex, ivec3(depthCoord, 0), 0).r;
+	float linearDepth = clipPlanes.x * clipPlanes.y / (clipPlanes.y - depth * (clipPlanes.y - clipPlanes.x));
+
+	// Calculate the vector that is a one step on vector from lightsource to
+	// the pixel of image.
+	vec2 deltaTextCoord = textCoo - lightScreenPos;
+ 	deltaTextCoord *= 1.0 /  float(samples) * density;
+
+	// Start from the first tap of this frame.
+	textCoo -= deltaTextCoord * float(tapOffset + 1);
+	float illuminationDecay = pow(decay, float(tapOffset));
+	float strideDecay = pow(decay, float(tapStride));
+
+	// Evaluate the summation of every tapStride-th shadow from occlusion texture
+	vec3 color = vec3(0);
+	for(int i = tapOffset; i < samples; i += tapStride)
+  	{
+		color += texture(occlusionTex, clamp(textCoo,0,1)).r * illuminationDecay * weight;
+		textCoo -= deltaTextCoord * float(tapStride);
+		illuminationDecay *= strideDecay;
+ 	}
+
+	// Taps of tapStride frames together are all the taps, so this frame stands for tapStride times more.
+	color *= lightColor * exposure * float(tapStride);
+
+	/// Find where this pixel was in the previous frame. The history is rejected when it is outside
+	/// of the screen or when it was covered by a different surface (disocclusion).
+	float age = 0.0;
+	vec3 history = vec3(0);
+	vec4 worldPosition = inverseViewProjection * vec4(inoutTexCoord * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
+	vec4 previousPosition = previousViewProjection * vec4(worldPosition.xyz / worldPosition.w, 1.0);
+	vec2 previousCoo = previousPosition.xy / previousPosition.w * 0.5 + 0.5;
+	if (resetHistory == false && previousPosition.w > 0.0 && all(greaterThanEqual(previousCoo, vec2(0))) && all(lessThanEqual(previousCoo, vec2(1))))
+	{
+		ivec2 historyCoord = ivec2(previousCoo * vec2(textureSize(previousPassTex, 0)));
+		historyCoord = min(historyCoord, textureSize(previousPassTex, 0) - 1);
+		vec4 previous = texelFetch(previousPassTex, historyCoord, 0);
+
+		// Clip space w of the previous frame is the linear depth the pixel should have had.
+		if (historyDepthThreshold <= 0.0 || abs(previous.a - previousPosition.w) <= historyDepthThreshold * previousPosition.w)
+		{
+			history = previous.rgb;
+			age = texelFetch(historyAgeTex, historyCoord, 0).r;
+		}
+	}
+
+	// Average all frames in the history equally until there are maxAge of them.
+	outAge = min(age + 1.0, maxAge);
+	outColor = vec4(mix(history, color, 1.0 / outAge), linearDepth);
+}
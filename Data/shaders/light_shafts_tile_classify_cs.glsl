@@ -0,0 +1,87 @@
+/**
+ * Compute shader that classifies tiles of the screen. The rays of the tile
+ * go from its pixels towards the light, so they all stay close to the line
+ * from the tile center. When every tile around that line is fully occluded,
+ * all taps of the tile read black and its light shafts are known to be zero.
+ * Tiles are appended to two lists drawn with indirect draws: tiles with
+ * light shafts and tiles that only get the normal scene.
+ * (c) 2014 Damian Nowakowski
+ */
+
+#version 430
+
+layout( local_size_x = 8, local_size_y = 8 ) in;
+
+/** Brightest occlusion of every tile */
+layout( r16f, binding = 0 ) uniform readonly image2D tileImage;
+
+/** Two indirect draw commands (count, instances, first, base instance): 0 - lit tiles, 1 - dark tiles */
+layout( std430, binding = 0 ) buffer TileCommands
+{
+	uint commands[8];
+};
+
+/** Lists of tiles (y in high and x in low 16 bits): lit tiles first, dark tiles after tileCount */
+layout( std430, binding = 1 ) writeonly buffer TileLists
+{
+	uint tiles[];
+};
+
+/** Position of the light source on screen */
+uniform vec2 lightScreenPos;
+
+/** Size of the screen in tiles (not rounded) */
+uniform vec2 screenTiles;
+
+/** Number of tiles on the screen (the offset of the dark tiles list) */
+uniform int tileCount;
+
+/**
+* This is uniform layout storing all needed light shafts parameters.
+* Using this layout application will update the uniform.
+*/
+layout( shared ) uniform ShaftsParams
+{
+    int samples;
+	float exposure;
+	float decay;
+	float density;
+	float weight;
+};
+
+void main(void)
+{
+	ivec2 tile = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 size = imageSize(tileImage);
+	if (tile.x >= size.x || tile.y >= size.y)
+	{
+		return;
+	}
+
+	/// All taps of the tile lie within half of the tile (in both axes) from the line going from
+	/// its center to (density) of the way to the light, and clamping to the screen keeps it so.
+	/// Points on the line half of the tile apart with their 3x3 tiles cover all of them
+	/// (with the filtered taps reading one texel further too).
+	vec2 start = vec2(tile) + 0.5;
+	vec2 end = start + (lightScreenPos * screenTiles - start) * density;
+	int steps = int(ceil(length(end - start) * 2.0));
+	bool lit = false;
+	for (int s = 0; s <= steps && lit == false; s++)
+	{
+		vec2 point = clamp(mix(start, end, float(s) / float(max(steps, 1))), vec2(0), screenTiles);
+		ivec2 center = min(ivec2(point), size - 1);
+		for (int y = -1; y <= 1; y++)
+		{
+			for (int x = -1; x <= 1; x++)
+			{
+				ivec2 neighbour = clamp(center + ivec2(x, y), ivec2(0), size - 1);
+				lit = lit || imageLoad(tileImage, neighbour).r > 0.0;
+			}
+		}
+	}
+
+	// Append the tile to its list, the number of instances of its draw command is the length of the list.
+	int list = lit ? 0 : 1;
+	uint index = atomicAdd(commands[list * 4 + 1], 1u);
+	tiles[list * tileCount + int(index)] = (uint(tile.y) << 16) | uint(tile.x);
+}
@@ -0,0 +1,26 @@
+/**
+ * Fragment shader of a post process that draws the normal scene on tiles
+ * without light shafts. It gives the same color as the light shafts shader
+ * with no light scattering, which is averaged with the normal scene there.
+ * (c) 2014 Damian Nowakowski
+ */
+
+#version 150
+
+/** Texture coords of the normal scene */
+in vec2 inoutTexCoord;
+
+/** Output color of the pixel */
+out vec4 outColor;
+
+/** Intensity of light shafts (0 - only the normal scene, 1 - full light shafts) */
+uniform float intensity;
+
+/** Array of textures: 0 - normal scene */
+uniform sampler2DArray tex;
+
+void main(void)
+{
+	vec4 scene = texture( tex, vec3( inoutTexCoord, 0 ) );
+	outColor = scene * (1.0 - intensity) + scene * 0.5 * intensity;
+}
@@ -0,0 +1,56 @@
+/**
+ * Compute shader that finds the brightest occlusion of every tile of the
+ * screen. Every work group reduces the occlusion texels under its tile,
+ * so the tile classification can check whole tiles with one read.
+ * (c) 2014 Damian Nowakowski
+ */
+
+#version 430
+
+/** Size of the tile of pixels reduced by one work group (the same as tiles drawn by the application) */
+#define TILE_SIZE 16
+
+layout( local_size_x = TILE_SIZE, local_size_y = TILE_SIZE ) in;
+
+/** Brightest occlusion of every tile */
+layout( r16f, binding = 0 ) uniform writeonly image2D tileImage;
+
+/** Occlusion: how much light passes */
+uniform sampler2D occlusionTex;
+
+/** Size of the screen in pixels */
+uniform vec2 screenSize;
+
+/** Brightest occlusion of the tile so far (positive floats keep their order as bits) */
+shared uint tileMax;
+
+void main(void)
+{
+	if (gl_LocalInvocationIndex == 0)
+	{
+		tileMax = 0;
+	}
+	barrier();
+
+	// The occlusion can be smaller than the screen, so find all of its texels under this tile.
+	ivec2 size = textureSize(occlusionTex, 0);
+	vec2 scale = vec2(size) / screenSize;
+	ivec2 first = ivec2(floor(vec2(gl_WorkGroupID.xy * TILE_SIZE) * scale));
+	ivec2 last = min(ivec2(ceil(vec2((gl_WorkGroupID.xy + 1) * TILE_SIZE) * scale)), size) - 1;
+
+	float occlusion = 0.0;
+	for (int y = first.y + int(gl_LocalInvocationID.y); y <= last.y; y += TILE_SIZE)
+	{
+		for (int x = first.x + int(gl_LocalInvocationID.x); x <= last.x; x += TILE_SIZE)
+		{
+			occlusion = max(occlusion, texelFetch(occlusionTex, ivec2(x, y), 0).r);
+		}
+	}
+	atomicMax(tileMax, floatBitsToUint(occlusion));
+	barrier();
+
+	if (gl_LocalInvocationIndex == 0)
+	{
+		imageStore(tileImage, ivec2(gl_WorkGroupID.xy), vec4(uintBitsToFloat(tileMax)));
+	}
+}
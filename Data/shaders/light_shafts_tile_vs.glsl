@@ -0,0 +1,33 @@
+/**
+ * Vertex shader of a post process that draws scene with light shafts
+ * only on the tiles from the list. Every instance is one tile and the
+ * quad filling the screen is shrunk onto it.
+ * (c) 2014 Damian Nowakowski
+ */
+
+#version 430
+
+in vec2 inPosition;
+in vec2 inTexCoord;
+out vec2 inoutTexCoord;
+
+/** Lists of tiles (y in high and x in low 16 bits) */
+layout( std430, binding = 1 ) readonly buffer TileLists
+{
+	uint tiles[];
+};
+
+/** Index of the first tile of the drawn list */
+uniform int listOffset;
+
+/** Size of the tile in (0,1) coordinates */
+uniform vec2 tileScale;
+
+void main()
+{
+	// Move the quad onto the tile, tiles on the right and top edges are cut by the screen.
+	uint tile = tiles[listOffset + gl_InstanceID];
+	vec2 origin = vec2(tile & 0xFFFFu, tile >> 16) * tileScale;
+	inoutTexCoord = min(origin + inTexCoord * tileScale, vec2(1));
+	gl_Position = vec4(inoutTexCoord * 2.0 - 1.0, 0, 1);
+}
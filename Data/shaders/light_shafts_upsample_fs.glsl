@@ -0,0 +1,78 @@
+/**
+ * Fragment shader of a post process that draws scene with light shafts
+ * rendered in lower resolution. Light shafts are upsampled with a joint
+ * bilateral filter guided by the full resolution depth, so they don't
+ * leak through the silhouettes of objects.
+ * (c) 2014 Damian Nowakowski
+ */
+
+#version 150
+
+/** Texture coords of occlusion image */
+in vec2 inoutTexCoord;
+
+/** Output color of the pixel */
+out vec4 outColor;
+
+/** Near and far plane of the camera (for depth linearization) */
+uniform vec2 clipPlanes;
+
+/** Relative depth difference at which the low resolution sample loses most of its weight */
+uniform float depthSigma;
+
+/** Intensity of light shafts (0 - only the normal scene, 1 - full light shafts) */
+uniform float intensity;
+
+/** Array of textures: 0 - normal scene */
+uniform sampler2DArray tex;
+
+/** Array of depth textures: 0 - normal scene */
+uniform sampler2DArray depthTex;
+
+/** Light scattering in lower resolution (rgb - color, a - linear depth) */
+uniform sampler2D scatterTex;
+
+void main(void)
+{
+	// Get the linear depth of this pixel
+	ivec2 depthCoord = ivec2(inoutTexCoord * vec2(textureSize(depthTex, 0).xy));
+	float depth = texelFetch(depthTex, ivec3(depthCoord, 0), 0).r;
+	float linearDepth = clipPlanes.x * clipPlanes.y / (clipPlanes.y - depth * (clipPlanes.y - clipPlanes.x));
+
+	// Find four low resolution texels around this pixel
+	ivec2 scatterSize = textureSize(scatterTex, 0);
+	vec2 position = inoutTexCoord * vec2(scatterSize) - 0.5;
+	ivec2 firstTexel = ivec2(floor(position));
+	vec2 fraction = position - vec2(firstTexel);
+
+	/// Weight every texel by its bilinear weight and by the similarity of its depth to this pixel depth.
+	/// Remember also the texel with the closest depth in case all of them are too different.
+	vec4 color = vec4(0);
+	vec3 closestColor = vec3(0);
+	float closestDistance = 1e30;
+	for (int i = 0; i < 4; i++)
+	{
+		ivec2 offset = ivec2(i % 2, i / 2);
+		vec4 scatterSample = texelFetch(scatterTex, clamp(firstTexel + offset, ivec2(0), scatterSize - 1), 0);
+
+		float bilinearWeight = (offset.x == 0 ? 1.0 - fraction.x : fraction.x) * (offset.y == 0 ? 1.0 - fraction.y : fraction.y);
+		float depthDistance = abs(scatterSample.a - linearDepth) / (depthSigma * linearDepth);
+		color += vec4(scatterSample.rgb, 1) * bilinearWeight * exp(-depthDistance * depthDistance);
+
+		if (depthDistance < closestDistance)
+		{
+			closestDistance = depthDistance;
+			closestColor = scatterSample.rgb;
+		}
+	}
+
+	// Use the filtered light shafts if there were any similar texels, otherwise the closest one
+	outColor = vec4(color.a > 0.001 ? color.rgb / color.a : closestColor, 0);
+
+	// Get the avarage of color from calculated light scattering and normal scene.
+	outColor += texture( tex, vec3( inoutTexCoord, 0 ) );
+	outColor *= 0.5;
+
+	// Fade the light shafts out to the normal scene when the light is leaving the view.
+	outColor = texture( tex, vec3( inoutTexCoord, 0 ) ) * (1.0 - intensity) + outColor * intensity;
+}
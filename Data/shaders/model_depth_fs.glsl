@@ -0,0 +1,11 @@
+/**
+ * Fragment shader used to draw only the depth of a 3D model.
+ * (c) 2014 Damian Nowakowski
+ */
+
+#version 150
+
+void main(void)
+{
+	// Nothing to do, only the depth is written.
+}
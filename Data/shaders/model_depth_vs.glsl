@@ -0,0 +1,20 @@
+/**
+ * Vertex shader used to draw only the depth of a 3D model.
+ * The position is calculated exactly like in the shaded pass,
+ * so its depth can be tested for equality.
+ * (c) 2014 Damian Nowakowski
+ */
+
+#version 150
+
+invariant gl_Position;
+
+uniform mat4 modelViewProjectionMatrix;
+
+in vec3 inPosition;
+
+void main()
+{
+	// Calculate the verticies screen position
+	gl_Position = modelViewProjectionMatrix * vec4(inPosition,1);
+}
@@ -48,9 +48,14 @@ uniform bool occlusion;
 
 out vec4 outColor;
 
+/** Occlusion written together with the shaded color when both are drawn in one pass (the model is black) */
+out vec4 outOcclusion;
+
 
 void main(void)
 {
+	outOcclusion = vec4(0,0,0,1);
+
 	if (occlusion == true)
 	{
 		// When there is occlusion only render only black occlusion
@@ -5,6 +5,9 @@
 
 #version 150
 
+/** The position must be the same as in the depth pre-pass */
+invariant gl_Position;
+
 uniform mat4 modelViewProjectionMatrix;
 
 in vec3 inPosition;
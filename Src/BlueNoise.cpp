@@ -0,0 +1,147 @@
+/**
+* Blue noise helper library.
+*
+* Simple static library generating tileable blue noise with the
+* void-and-cluster method. Neighbour values of blue noise are as different
+* as possible, so it hides banding with the noise that is easy to filter.
+*
+* (c) 2014 Damian Nowakowski
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include "BlueNoise.h"
+
+/**
+* Generate the tileable blue noise.
+* @param size	- Width and height of the noise in texels
+* @param values	- Output values of the noise, (size * size) of them in (0,1) range, row by row
+*/
+void BlueNoise::Generate(int size, std::vector<GLfloat> &values)
+{
+	int count = size * size;
+
+	/// Every point gives the energy to texels around it with the gaussian falloff.
+	/// The noise is tileable, so the distance wraps around the borders.
+	const GLfloat sigma = 1.5f;
+	std::vector<GLfloat> kernel(count);
+	for (int y = 0; y < size; y++)
+	{
+		for (int x = 0; x < size; x++)
+		{
+			int dx = std::min(x, size - x);
+			int dy = std::min(y, size - y);
+			kernel[y * size + x] = std::exp(-(GLfloat)(dx * dx + dy * dy) / (2.0f * sigma * sigma));
+		}
+	}
+
+	/// Start from the random pattern with every tenth texel set. Always use the same seed,
+	/// so the noise is the same in every run.
+	std::vector<bool> pattern(count, false);
+	std::vector<GLfloat> energy(count, 0.0f);
+	std::mt19937 random(2014);
+	int points = 0;
+	while (points < count / 10)
+	{
+		int index = (int)(random() % count);
+		if (pattern[index] == false)
+		{
+			SetPoint(size, kernel, pattern, energy, index, true);
+			points++;
+		}
+	}
+
+	/// Move points from the tightest clusters to the largest voids until
+	/// the point removed from the cluster would go back to the same place.
+	/// It takes much less iterations than texels, but don't let it run forever.
+	for (int i = 0; i < count; i++)
+	{
+		int cluster = Find(pattern, energy, true);
+		SetPoint(size, kernel, pattern, energy, cluster, false);
+		int largestVoid = Find(pattern, energy, false);
+		SetPoint(size, kernel, pattern, energy, largestVoid, true);
+		if (largestVoid == cluster)
+		{
+			break;
+		}
+	}
+
+	/// Rank the points of this pattern by removing the tightest clusters one by one.
+	values.assign(count, 0.0f);
+	std::vector<bool> prototype = pattern;
+	std::vector<GLfloat> prototypeEnergy = energy;
+	for (int rank = points - 1; rank >= 0; rank--)
+	{
+		int cluster = Find(pattern, energy, true);
+		SetPoint(size, kernel, pattern, energy, cluster, false);
+		values[cluster] = (GLfloat)rank;
+	}
+
+	/// Rank the rest of texels by filling the largest voids of the pattern one by one.
+	pattern = prototype;
+	energy = prototypeEnergy;
+	for (int rank = points; rank < count; rank++)
+	{
+		int largestVoid = Find(pattern, energy, false);
+		SetPoint(size, kernel, pattern, energy, largestVoid, true);
+		values[largestVoid] = (GLfloat)rank;
+	}
+
+	// Go from ranks to the (0,1) range.
+	for (int i = 0; i < count; i++)
+	{
+		values[i] = (values[i] + 0.5f) / (GLfloat)count;
+	}
+}
+
+/**
+* Add or remove the point from the pattern and update the energy of all texels.
+* @param size		- Width and height of the noise in texels
+* @param kernel		- Energy that the point gives to texels around, indexed by the distance in texels
+* @param pattern	- Pattern of points
+* @param energy		- Energy of every texel of the pattern
+* @param index		- Index of the texel to change
+* @param value		- True to add the point, false to remove it
+*/
+void BlueNoise::SetPoint(int size, const std::vector<GLfloat> &kernel, std::vector<bool> &pattern, std::vector<GLfloat> &energy, int index, bool value)
+{
+	pattern[index] = value;
+	GLfloat sign = value ? 1.0f : -1.0f;
+	int pointX = index % size;
+	int pointY = index / size;
+	for (int y = 0; y < size; y++)
+	{
+		int dy = (y - pointY + size) % size;
+		for (int x = 0; x < size; x++)
+		{
+			int dx = (x - pointX + size) % size;
+			energy[y * size + x] += sign * kernel[dy * size + dx];
+		}
+	}
+}
+
+/**
+* Find the texel with the highest energy among points (the tightest cluster) or
+* with the lowest energy among empty texels (the largest void).
+* @param pattern	- Pattern of points
+* @param energy		- Energy of every texel of the pattern
+* @param cluster	- True to find the tightest cluster, false to find the largest void
+* @returns the index of the found texel
+*/
+int BlueNoise::Find(const std::vector<bool> &pattern, const std::vector<GLfloat> &energy, bool cluster)
+{
+	int found = -1;
+	for (int i = 0; i < (int)pattern.size(); i++)
+	{
+		if (pattern[i] != cluster)
+		{
+			continue;
+		}
+		if (found < 0 || (cluster ? energy[i] > energy[found] : energy[i] < energy[found]))
+		{
+			found = i;
+		}
+	}
+	return found;
+}
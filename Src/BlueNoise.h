@@ -0,0 +1,47 @@
+/**
+* Blue noise helper library.
+*
+* Simple static library generating tileable blue noise with the
+* void-and-cluster method. Neighbour values of blue noise are as different
+* as possible, so it hides banding with the noise that is easy to filter.
+*
+* (c) 2014 Damian Nowakowski
+*/
+
+#pragma once
+
+#include <vector>
+#include <GL/glew.h>
+
+class BlueNoise
+{
+public:
+	/**
+	* Generate the tileable blue noise.
+	* @param size	- Width and height of the noise in texels
+	* @param values	- Output values of the noise, (size * size) of them in (0,1) range, row by row
+	*/
+	static void Generate(int size, std::vector<GLfloat> &values);
+
+private:
+	/**
+	* Add or remove the point from the pattern and update the energy of all texels.
+	* @param size		- Width and height of the noise in texels
+	* @param kernel		- Energy that the point gives to texels around, indexed by the distance in texels
+	* @param pattern	- Pattern of points
+	* @param energy		- Energy of every texel of the pattern
+	* @param index		- Index of the texel to change
+	* @param value		- True to add the point, false to remove it
+	*/
+	static void SetPoint(int size, const std::vector<GLfloat> &kernel, std::vector<bool> &pattern, std::vector<GLfloat> &energy, int index, bool value);
+
+	/**
+	* Find the texel with the highest energy among points (the tightest cluster) or
+	* with the lowest energy among empty texels (the largest void).
+	* @param pattern	- Pattern of points
+	* @param energy		- Energy of every texel of the pattern
+	* @param cluster	- True to find the tightest cluster, false to find the largest void
+	* @returns the index of the found texel
+	*/
+	static int Find(const std::vector<bool> &pattern, const std::vector<GLfloat> &energy, bool cluster);
+};
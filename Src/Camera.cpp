@@ -28,6 +28,11 @@ Camera::Camera()
 	renderWidth		= (int)localINIReader->GetInteger("Camera", "Width", 640);
 	renderHeight	= (int)localINIReader->GetInteger("Camera", "Height", 480);
 
+	// At the beginning render targets are of the size of the final image.
+	outputWidth		= renderWidth;
+	outputHeight	= renderHeight;
+	renderScale		= 1;
+
 	// Get from ini file or set frustum parameters and remember them
 	FOV		= (GLfloat)glm::radians((GLfloat)localINIReader->GetReal("Camera", "FOV", 90.0));
 	ratio	= (GLfloat)renderWidth / (GLfloat)renderHeight;
@@ -168,4 +173,33 @@ bool Camera::HandleInput()
 
 	// Return if camera is moving and has to be updated
 	return isMoving;
+}
+
+/**
+ * Scale the size of render targets relative to the final image (the aspect ratio stays the same).
+ * @param scale - the new render scale in (0,1]
+ */
+void Camera::SetRenderScale(GLfloat scale)
+{
+	renderScale		= glm::clamp(scale, 0.0f, 1.0f);
+	renderWidth		= glm::max(1, (int)(outputWidth * renderScale + 0.5f));
+	renderHeight	= glm::max(1, (int)(outputHeight * renderScale + 0.5f));
+}
+
+/**
+ * Change the size of the final image (after the window was resized). The aspect ratio follows it
+ * and render targets keep their scale relative to it.
+ * @param width - the new width of the final image
+ * @param height - the new height of the final image
+ */
+void Camera::SetOutputSize(int width, int height)
+{
+	outputWidth		= glm::max(1, width);
+	outputHeight	= glm::max(1, height);
+	SetRenderScale(renderScale);
+
+	// The projection stretches the scene to the new shape, so it is made again with the new ratio.
+	ratio				= (GLfloat)outputWidth / (GLfloat)outputHeight;
+	projectionMatrix	= glm::mat4() * glm::perspective(FOV, ratio, fnear, ffar);
+	viewProjectionMatrix = projectionMatrix * viewMatrix;
 }
\ No newline at end of file
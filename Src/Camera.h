@@ -26,6 +26,9 @@ public:
 
 	int renderWidth;	///< Width of render target and camera
 	int renderHeight;	///< Height of render target and camera
+	int outputWidth;	///< Width of the final image on the screen (render targets are scaled from it)
+	int outputHeight;	///< Height of the final image on the screen (render targets are scaled from it)
+	GLfloat renderScale;	///< Size of render targets relative to the final image
 	glm::vec3 position;	///< Position of a camera
 	
 	/**
@@ -48,6 +51,16 @@ public:
 	 */
 	GLfloat GetRatio() { return ratio; }
 
+	/**
+	 * Get near plane of this camera frustum.
+	 */
+	GLfloat GetNear() { return fnear; }
+
+	/**
+	 * Get far plane of this camera frustum.
+	 */
+	GLfloat GetFar() { return ffar; }
+
 	/**
 	 * Update the position, rotation and matrices of this camera.
 	 * @param deltaTime - the portion of time thas passed from previous update.
@@ -60,6 +73,20 @@ public:
 	 */
 	bool HandleInput();
 
+	/**
+	 * Scale the size of render targets relative to the final image (the aspect ratio stays the same).
+	 * @param scale - the new render scale in (0,1]
+	 */
+	void SetRenderScale(GLfloat scale);
+
+	/**
+	 * Change the size of the final image (after the window was resized). The aspect ratio follows it
+	 * and render targets keep their scale relative to it.
+	 * @param width - the new width of the final image
+	 * @param height - the new height of the final image
+	 */
+	void SetOutputSize(int width, int height);
+
 private:
 
 	GLfloat FOV;					///< Field Of View
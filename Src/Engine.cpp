@@ -10,6 +10,10 @@
 #include "Engine.h"
 #include "Scene.h"
 #include "Window.h"
+#include "Profiler.h"
+#include "GLState.h"
+#include "ResolutionGovernor.h"
+#include "LightShafts.h"
 
 // Set the default value of instance pointer to avoid memory ridings
 Engine * Engine::engine = NULL;
@@ -17,7 +21,8 @@ Engine * Engine::engine = NULL;
 /**
  * Definition of key listener inside the engine that is listening for
  * the Esc button. The Esc button stops the engine and thus the application
- * starts to nicely close.
+ * starts to nicely close. The Q button switches the quality of light shafts
+ * and the P button switches the depth pre-pass.
  */
 void OnKey(GLFWwindow * window, int key, int scancode, int action, int mods)
 {	
@@ -25,6 +30,33 @@ void OnKey(GLFWwindow * window, int key, int scancode, int action, int mods)
 	{
 		ENGINE->StopEngine();
 	}
+
+	// The Q button switches the quality of light shafts.
+	if (key == GLFW_KEY_Q && action == GLFW_PRESS)
+	{
+		LightShafts * lightShafts = ENGINE->scene->lightShafts;
+		lightShafts->SetQuality((lightShafts->quality == SHAFTS_QUALITY_HIGH) ? SHAFTS_QUALITY_LOW : SHAFTS_QUALITY_HIGH);
+	}
+
+	// The P button switches the depth pre-pass of the normal scene.
+	if (key == GLFW_KEY_P && action == GLFW_PRESS)
+	{
+		ENGINE->scene->depthPrepass = !ENGINE->scene->depthPrepass;
+		printf("Depth pre-pass %s\n", ENGINE->scene->depthPrepass ? "on" : "off");
+	}
+}
+
+/**
+ * Definition of the listener of the size of the window frame buffer. It changes when the window
+ * is resized or moved to the monitor with other scaling (DPI), and the final image follows it.
+ * A minimized window has no size, so nothing changes until it is restored.
+ */
+void OnFramebufferSize(GLFWwindow *, int width, int height)
+{
+	if (width > 0 && height > 0)
+	{
+		ENGINE->scene->SetOutputSize(width, height);
+	}
 }
 
 /**
@@ -53,6 +85,9 @@ void Engine::Create()
  */
 void Engine::Init()
 {
+	// Nothing failed yet.
+	exitCode = EXIT_SUCCESS;
+
 	// Create a config reader with configuration ini file so it can be used in future
 	config = new INIReader(CONFIG_PATH);
 
@@ -74,15 +109,34 @@ void Engine::Init()
 		return;
 	}
 
+	// Create the profiler measuring parts of the frame (it needs the opengl context).
+	profiler = new Profiler();
+
+	// Start remembering the opengl state of the new context.
+	GLState::Init();
+
 	// Create and init the scene with all objects inside
 	// Init cannot be inside constructor, because many objects
 	// inside scene needs an access to scene during creation.
 	scene = new Scene();
 	scene->Init();
+
+	// Create the governor scaling render targets of the scene (it needs the scene).
+	governor = new ResolutionGovernor();
 	
 	// Set the callback for key action (listening to Esc to close an application)
 	glfwSetKeyCallback(window->glfwWindow, OnKey);
 
+	/// The resizable window has the final image of the size of its frame buffer (which is bigger than
+	/// the window on monitors with scaling), from the beginning and after every change.
+	if (window->resizable)
+	{
+		glfwSetFramebufferSizeCallback(window->glfwWindow, OnFramebufferSize);
+		int width, height;
+		glfwGetFramebufferSize(window->glfwWindow, &width, &height);
+		OnFramebufferSize(window->glfwWindow, width, height);
+	}
+
 	// Remember the time for calculating the tick time
 	prevTime = glfwGetTime();
 
@@ -124,6 +178,24 @@ void Engine::StopEngine()
 	isRunning = false;
 }
 
+/**
+ * Stop the engine because a check failed, so the application exits with the failure code.
+ */
+void Engine::FailEngine()
+{
+	exitCode = EXIT_FAILURE;
+	isRunning = false;
+}
+
+/**
+ * Get the code the application has to exit with.
+ * @returns EXIT_FAILURE when a check failed, EXIT_SUCCESS otherwise.
+ */
+int Engine::GetExitCode()
+{
+	return exitCode;
+}
+
 /**
  * Poll all engine events. Best use inside the main loop.
  */
@@ -164,7 +236,11 @@ void Engine::Poll()
 		{
 			renderTimer -= RENDER_PERIOD;
 		}
+		governor->BeginFrame();
 		scene->OnDraw();
+		governor->EndFrame();
+		GLState::ReportStatistics();
+		profiler->EndFrame();
 
 		// At the end flush opengl and swap buffers.
 		glFlush();
@@ -180,7 +256,10 @@ void Engine::Poll()
  */
 Engine::~Engine()
 {
-	delete config;
-	delete window;
+	// Objects owning opengl objects go first, the window destroys the context.
+	delete governor;
 	delete scene;
+	delete profiler;
+	delete window;
+	delete config;
 }
\ No newline at end of file
@@ -42,6 +42,8 @@
 // Predefine classes for visibility
 class Scene;
 class Window;
+class Profiler;
+class ResolutionGovernor;
 class TweakBar;
 
 class Engine
@@ -51,6 +53,8 @@ public:
 	INIReader*	config;	///< The configuration ini file reader
 	Window*		window;	///< The glfw window (and opengl initializator)
 	Scene*		scene;	///< The scene where all fun stuff happens
+	Profiler*	profiler;	///< The profiler measuring parts of the frame
+	ResolutionGovernor*	governor;	///< The governor scaling render targets to hold the GPU frame time
 
 	/**
 	 * Get the engine instance (singleton).
@@ -86,6 +90,17 @@ public:
 	 */
 	void StopEngine();
 
+	/**
+	 * Stop the engine because a check failed, so the application exits with the failure code.
+	 */
+	void FailEngine();
+
+	/**
+	 * Get the code the application has to exit with.
+	 * @returns EXIT_FAILURE when a check failed, EXIT_SUCCESS otherwise.
+	 */
+	int GetExitCode();
+
 	/**
 	 * Poll all engine events. Best use inside the main loop.
 	 */
@@ -101,6 +116,7 @@ private:
 	TweakBar * tweakBar;	///< The tweak bar
 	static Engine* engine;	///< The handler of the engine instance
 	bool isRunning;			///< Flag telling if the engine is running
+	int exitCode;			///< Code the application exits with
 	
 	double prevTime;		///< Value of previous time used to calculating delta time
 
@@ -0,0 +1,554 @@
+/**
+* LightShafts example.
+*
+* This is a frame graph class. Passes of the frame declare textures they
+* read and write, and the graph culls passes that don't lead to outputs,
+* orders them, takes transient textures from the render target pool (sharing
+* one texture between transients whose lifetimes don't overlap), makes frame
+* buffers and clears them, so passes only draw.
+*
+* (c) 2014 Damian Nowakowski
+*/
+
+#include "FrameGraph.h"
+#include "RenderTargetPool.h"
+#include "Profiler.h"
+#include "GLState.h"
+#include "glm/glm.hpp"
+
+/**
+* Simple constructor
+* @param pool - the pool transient textures are taken from (and given back to when the graph is deleted)
+*/
+FrameGraph::FrameGraph(RenderTargetPool * pool) : pool(pool)
+{
+}
+
+/**
+* Declare the texture created by the graph only for the time it is used in the frame.
+* @param name	- Name of the texture
+* @param desc	- Description of the texture
+* @return Index of the texture resource
+*/
+int FrameGraph::CreateTexture(const char *name, const FrameGraphTextureDesc &desc)
+{
+	Resource resource;
+	resource.name = name;
+	resource.desc = desc;
+	resource.transient = true;
+	resource.texture = 0;
+	resource.physical = -1;
+	resource.firstUse = resource.lastUse = -1;
+	resources.push_back(resource);
+	return (int)resources.size() - 1;
+}
+
+/**
+* Declare the texture created outside of the graph (it lives all the time).
+* @param name		- Name of the texture
+* @param texture	- Handler of the texture (0 for the screen)
+* @param desc		- Description of the texture
+* @return Index of the texture resource
+*/
+int FrameGraph::ImportTexture(const char *name, GLuint texture, const FrameGraphTextureDesc &desc)
+{
+	int index = CreateTexture(name, desc);
+	resources[index].transient = false;
+	resources[index].texture = texture;
+	return index;
+}
+
+/**
+* Add the pass. Passes are ordered by textures they read and write, passes
+* not depending on each other stay in the order they were added.
+* @param name	- Name of the pass (also the name of its profiler section)
+* @param pass	- The pass (the graph deletes it)
+* @return Index of the pass
+*/
+int FrameGraph::AddPass(const char *name, FrameGraphPass * pass)
+{
+	Pass newPass;
+	newPass.name = name;
+	newPass.pass = pass;
+	newPass.frameBuffer = 0;
+	newPass.culled = false;
+	passes.push_back(newPass);
+	return (int)passes.size() - 1;
+}
+
+/**
+* Declare the texture the pass reads (samples).
+* @param pass		- Index of the pass
+* @param resource	- Index of the texture
+*/
+void FrameGraph::Read(int pass, int resource)
+{
+	passes[pass].reads.push_back(resource);
+}
+
+/**
+* Declare the texture the pass writes by itself, without the frame buffer of the graph.
+* @param pass		- Index of the pass
+* @param resource	- Index of the texture
+*/
+void FrameGraph::Write(int pass, int resource)
+{
+	passes[pass].writes.push_back(resource);
+}
+
+/**
+* Declare the texture the pass renders to. Color textures are attached in the order of
+* declaring them, the depth texture to the depth attachment.
+* @param pass		- Index of the pass
+* @param resource	- Index of the texture
+* @param clear		- False when the pass writes every texel itself, so it doesn't have to be cleared
+*/
+void FrameGraph::Attach(int pass, int resource, bool clear)
+{
+	passes[pass].attachments.push_back(resource);
+	passes[pass].clears.push_back(clear);
+}
+
+/**
+* Mark the texture as the output of the frame. Passes not leading to any output are culled.
+* @param resource - Index of the texture
+*/
+void FrameGraph::SetOutput(int resource)
+{
+	outputs.push_back(resource);
+}
+
+/**
+* Cull, order and allocate everything declared so far. Run it once before executing.
+*/
+void FrameGraph::Compile()
+{
+	int passCount = (int)passes.size();
+
+	/// Every pass writing the texture goes after passes writing it before (in the order of adding),
+	/// and every pass reading it goes after all of them.
+	std::vector< std::vector<int> > dependencies(passCount);
+	for (int i = 0; i < passCount; i++)
+	{
+		for (int j = 0; j < passCount; j++)
+		{
+			if (i == j)
+			{
+				continue;
+			}
+			bool depends = false;
+			for (int r = 0; r < (int)passes[i].reads.size() && depends == false; r++)
+			{
+				depends = Writes(passes[j], passes[i].reads[r]);
+			}
+			for (int r = 0; r < (int)resources.size() && depends == false && j < i; r++)
+			{
+				depends = Writes(passes[i], r) && Writes(passes[j], r);
+			}
+			if (depends)
+			{
+				dependencies[i].push_back(j);
+			}
+		}
+	}
+
+	/// Take passes whose dependencies are already taken, always the earliest added one of them.
+	/// When none can be taken the graph has a cycle, so the rest goes in the order of adding.
+	std::vector<int> sorted;
+	std::vector<bool> taken(passCount, false);
+	while ((int)sorted.size() < passCount)
+	{
+		int next = -1;
+		for (int i = 0; i < passCount && next < 0; i++)
+		{
+			bool ready = (taken[i] == false);
+			for (int d = 0; d < (int)dependencies[i].size() && ready; d++)
+			{
+				ready = taken[dependencies[i][d]];
+			}
+			if (ready)
+			{
+				next = i;
+			}
+		}
+		if (next < 0)
+		{
+			printf("Frame graph has a cycle, passes go in the order of adding.\n");
+			for (int i = 0; i < passCount; i++)
+			{
+				if (taken[i] == false)
+				{
+					next = i;
+					break;
+				}
+			}
+		}
+		taken[next] = true;
+		sorted.push_back(next);
+	}
+
+	/// Go from the end and keep only passes writing textures needed by outputs or by passes kept before.
+	/// Textures written by a kept pass are needed too, because it draws over what earlier passes wrote.
+	std::vector<bool> needed(resources.size(), false);
+	for (int i = 0; i < (int)outputs.size(); i++)
+	{
+		needed[outputs[i]] = true;
+	}
+	for (int i = passCount - 1; i >= 0; i--)
+	{
+		Pass &pass = passes[sorted[i]];
+		pass.culled = true;
+		for (int r = 0; r < (int)resources.size() && pass.culled; r++)
+		{
+			pass.culled = (needed[r] == false || Writes(pass, r) == false);
+		}
+		if (pass.culled)
+		{
+			continue;
+		}
+		for (int r = 0; r < (int)resources.size(); r++)
+		{
+			if (Writes(pass, r))
+			{
+				needed[r] = true;
+			}
+		}
+		for (int r = 0; r < (int)pass.reads.size(); r++)
+		{
+			needed[pass.reads[r]] = true;
+		}
+	}
+	order.clear();
+	for (int i = 0; i < passCount; i++)
+	{
+		if (passes[sorted[i]].culled == false)
+		{
+			order.push_back(sorted[i]);
+		}
+	}
+
+	// Find the lifetime of every texture: from the first to the last pass using it.
+	for (int i = 0; i < (int)order.size(); i++)
+	{
+		Pass &pass = passes[order[i]];
+		for (int r = 0; r < (int)resources.size(); r++)
+		{
+			bool used = Writes(pass, r);
+			for (int j = 0; j < (int)pass.reads.size() && used == false; j++)
+			{
+				used = (pass.reads[j] == r);
+			}
+			if (used)
+			{
+				if (resources[r].firstUse < 0)
+				{
+					resources[r].firstUse = i;
+				}
+				resources[r].lastUse = i;
+			}
+		}
+	}
+
+	/// Take transient textures from the pool when their lifetimes start. A texture of the same description
+	/// whose last user already passed is used again instead of taking a new one.
+	for (int i = 0; i < (int)order.size(); i++)
+	{
+		for (int r = 0; r < (int)resources.size(); r++)
+		{
+			Resource &resource = resources[r];
+			if (resource.transient == false || resource.firstUse != i)
+			{
+				continue;
+			}
+			for (int p = 0; p < (int)physicals.size() && resource.physical < 0; p++)
+			{
+				if (physicals[p].freeAfter < i && RenderTargetPool::SameTexture(physicals[p].desc, resource.desc))
+				{
+					resource.physical = p;
+				}
+			}
+			if (resource.physical < 0)
+			{
+				Physical physical;
+				physical.desc = resource.desc;
+				physical.texture = pool->Acquire(resource.desc);
+				physicals.push_back(physical);
+				resource.physical = (int)physicals.size() - 1;
+			}
+			physicals[resource.physical].freeAfter = resource.lastUse;
+			resource.texture = physicals[resource.physical].texture;
+		}
+	}
+
+	/// Clear attachments only where their textures are written first in the frame (later passes draw over them)
+	/// and only when the pass doesn't write every texel by itself.
+	std::vector<bool> written(resources.size(), false);
+	for (int i = 0; i < (int)order.size(); i++)
+	{
+		Pass &pass = passes[order[i]];
+		for (int a = 0; a < (int)pass.attachments.size(); a++)
+		{
+			int r = pass.attachments[a];
+			pass.clears[a] = pass.clears[a] && resources[r].desc.clear && written[r] == false;
+		}
+		for (int r = 0; r < (int)resources.size(); r++)
+		{
+			written[r] = written[r] || Writes(pass, r);
+		}
+	}
+
+	/// Make frame buffers of passes rendering to attachments. Passes rendering to the same textures
+	/// share one frame buffer, so it isn't bound again when they go one after another.
+	for (int i = 0; i < (int)order.size(); i++)
+	{
+		Pass &pass = passes[order[i]];
+		if (pass.attachments.empty())
+		{
+			continue;
+		}
+		for (int j = 0; j < i && pass.frameBuffer == 0; j++)
+		{
+			const Pass &previous = passes[order[j]];
+			bool same = (previous.attachments.size() == pass.attachments.size());
+			for (int a = 0; a < (int)pass.attachments.size() && same; a++)
+			{
+				same = (resources[previous.attachments[a]].texture == resources[pass.attachments[a]].texture);
+			}
+			if (same)
+			{
+				pass.frameBuffer = previous.frameBuffer;
+			}
+		}
+		if (pass.frameBuffer != 0)
+		{
+			continue;
+		}
+
+		std::vector<GLenum> drawBuffers;
+		glGenFramebuffers(1, &pass.frameBuffer);
+		GLState::BindFramebuffer(GL_DRAW_FRAMEBUFFER, pass.frameBuffer);
+		for (int a = 0; a < (int)pass.attachments.size(); a++)
+		{
+			const Resource &resource = resources[pass.attachments[a]];
+			GLenum attachment = GL_DEPTH_ATTACHMENT;
+			if (IsDepth(pass.attachments[a]) == false)
+			{
+				attachment = GL_COLOR_ATTACHMENT0 + (GLenum)drawBuffers.size();
+				drawBuffers.push_back(attachment);
+			}
+			if (resource.desc.layers > 0)
+			{
+				glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, attachment, resource.texture, 0, 0);
+			}
+			else
+			{
+				glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, attachment, GL_TEXTURE_2D, resource.texture, 0);
+			}
+		}
+		if (drawBuffers.empty())
+		{
+			glDrawBuffer(GL_NONE);
+		}
+		else
+		{
+			glDrawBuffers((GLsizei)drawBuffers.size(), &drawBuffers[0]);
+		}
+		if (glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		{
+			printf("Frame buffer of the pass %s is not complete.\n", pass.name.c_str());
+		}
+		GLState::BindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+		frameBuffers.push_back(pass.frameBuffer);
+	}
+}
+
+/**
+* Execute all passes in the compiled order, each in its own profiler section.
+*/
+void FrameGraph::Execute()
+{
+	// Remember the profiler so we can measure every pass
+	Profiler * localProfiler = ENGINE->profiler;
+
+	/// Passes binding their own frame buffers leave any of them bound, so after them
+	/// the frame buffer of the next pass is bound again even when it's the same.
+	GLuint boundFrameBuffer = 0;
+	for (int i = 0; i < (int)order.size(); i++)
+	{
+		Pass &pass = passes[order[i]];
+		localProfiler->BeginSection(pass.name.c_str());
+
+		if (pass.frameBuffer != 0)
+		{
+			if (pass.frameBuffer != boundFrameBuffer)
+			{
+				const FrameGraphTextureDesc &desc = resources[pass.attachments[0]].desc;
+				GLState::BindFramebuffer(GL_DRAW_FRAMEBUFFER, pass.frameBuffer);
+				GLState::Viewport(0, 0, desc.width, desc.height);
+				boundFrameBuffer = pass.frameBuffer;
+			}
+
+			int colorBuffer = 0;
+			for (int a = 0; a < (int)pass.attachments.size(); a++)
+			{
+				bool depth = IsDepth(pass.attachments[a]);
+				if (pass.clears[a])
+				{
+					glClearBufferfv(depth ? GL_DEPTH : GL_COLOR, depth ? 0 : colorBuffer, resources[pass.attachments[a]].desc.clearValue);
+				}
+				if (depth == false)
+				{
+					colorBuffer++;
+				}
+			}
+		}
+
+		pass.pass->Execute(this);
+
+		if (pass.frameBuffer == 0 || pass.writes.empty() == false)
+		{
+			boundFrameBuffer = 0;
+		}
+
+		localProfiler->EndSection();
+	}
+}
+
+/**
+* Print the compiled passes and the memory of transient textures.
+*/
+void FrameGraph::Dump()
+{
+	printf("Frame graph:\n");
+	for (int i = 0; i < (int)order.size(); i++)
+	{
+		const Pass &pass = passes[order[i]];
+		printf("  %d. %s", i + 1, pass.name.c_str());
+		for (int r = 0; r < (int)pass.reads.size(); r++)
+		{
+			printf("%s%s", (r == 0) ? ", reads " : ", ", resources[pass.reads[r]].name.c_str());
+		}
+		for (int a = 0; a < (int)pass.attachments.size(); a++)
+		{
+			printf("%s%s%s", (a == 0) ? ", renders to " : ", ", resources[pass.attachments[a]].name.c_str(), pass.clears[a] ? " (cleared)" : "");
+		}
+		for (int w = 0; w < (int)pass.writes.size(); w++)
+		{
+			printf("%s%s", (w == 0) ? ", writes " : ", ", resources[pass.writes[w]].name.c_str());
+		}
+		printf("\n");
+	}
+	for (int i = 0; i < (int)passes.size(); i++)
+	{
+		if (passes[i].culled)
+		{
+			printf("  Culled %s\n", passes[i].name.c_str());
+		}
+	}
+
+	/// Transient memory is the memory of created textures. Without sharing every transient would have
+	/// its own texture, and the peak is the most that transients alive at once need.
+	GLfloat unsharedMegabytes = 0;
+	GLfloat peakMegabytes = 0;
+	for (int r = 0; r < (int)resources.size(); r++)
+	{
+		if (resources[r].transient && resources[r].physical >= 0)
+		{
+			printf("  %s: texture %d, passes %d-%d, %.1f MB\n", resources[r].name.c_str(), resources[r].physical,
+				resources[r].firstUse + 1, resources[r].lastUse + 1, RenderTargetPool::GetMegabytes(resources[r].desc));
+			unsharedMegabytes += RenderTargetPool::GetMegabytes(resources[r].desc);
+		}
+	}
+	for (int i = 0; i < (int)order.size(); i++)
+	{
+		GLfloat aliveMegabytes = 0;
+		for (int r = 0; r < (int)resources.size(); r++)
+		{
+			if (resources[r].transient && resources[r].firstUse <= i && resources[r].lastUse >= i)
+			{
+				aliveMegabytes += RenderTargetPool::GetMegabytes(resources[r].desc);
+			}
+		}
+		peakMegabytes = glm::max(peakMegabytes, aliveMegabytes);
+	}
+	printf("Transient memory: %.1f MB in %d textures (%.1f MB without sharing), peak %.1f MB alive at once, %d frame buffers\n",
+		GetTransientMegabytes(), (int)physicals.size(), unsharedMegabytes, peakMegabytes, (int)frameBuffers.size());
+}
+
+/**
+* Get the texture handler of the resource (valid after compiling).
+* @param resource - Index of the texture
+* @return Handler of the texture
+*/
+GLuint FrameGraph::GetTexture(int resource)
+{
+	return resources[resource].texture;
+}
+
+/**
+* Get the memory taken by textures taken by the graph.
+* @return Memory in megabytes
+*/
+GLfloat FrameGraph::GetTransientMegabytes()
+{
+	GLfloat megabytes = 0;
+	for (int i = 0; i < (int)physicals.size(); i++)
+	{
+		megabytes += RenderTargetPool::GetMegabytes(physicals[i].desc);
+	}
+	return megabytes;
+}
+
+/**
+* Check if the pass writes the texture (by itself or as the attachment).
+* @param pass		- The pass
+* @param resource	- Index of the texture
+* @return True when it writes it
+*/
+bool FrameGraph::Writes(const Pass &pass, int resource)
+{
+	for (int i = 0; i < (int)pass.writes.size(); i++)
+	{
+		if (pass.writes[i] == resource)
+		{
+			return true;
+		}
+	}
+	for (int i = 0; i < (int)pass.attachments.size(); i++)
+	{
+		if (pass.attachments[i] == resource)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+* Check if the texture has a depth format.
+* @param resource - Index of the texture
+* @return True for the depth texture
+*/
+bool FrameGraph::IsDepth(int resource)
+{
+	return RenderTargetPool::IsDepthFormat(resources[resource].desc.internalFormat);
+}
+
+/**
+* Simple destructor clearing all data.
+*/
+FrameGraph::~FrameGraph()
+{
+	for (int i = 0; i < (int)passes.size(); i++)
+	{
+		delete passes[i].pass;
+	}
+	for (int i = 0; i < (int)physicals.size(); i++)
+	{
+		pool->Release(physicals[i].texture);
+	}
+	for (int i = 0; i < (int)frameBuffers.size(); i++)
+	{
+		GLState::DeleteFramebuffers(1, &frameBuffers[i]);
+	}
+}
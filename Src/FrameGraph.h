@@ -0,0 +1,210 @@
+#pragma once
+
+/**
+* LightShafts example.
+*
+* This is a frame graph class. Passes of the frame declare textures they
+* read and write, and the graph culls passes that don't lead to outputs,
+* orders them, takes transient textures from the render target pool (sharing
+* one texture between transients whose lifetimes don't overlap), makes frame
+* buffers and clears them, so passes only draw.
+*
+* (c) 2014 Damian Nowakowski
+*/
+
+#include <string>
+#include <vector>
+#include "Engine.h"
+
+class FrameGraph;
+class RenderTargetPool;
+
+/**
+* Description of the texture of the frame graph.
+*/
+struct FrameGraphTextureDesc
+{
+	GLenum internalFormat;	///< Format of the texture
+	int width;				///< Width of the texture
+	int height;				///< Height of the texture
+	int layers;				///< Number of layers of the texture array (0 for a simple texture)
+	int levels;				///< Number of mip levels of the texture (1 for only the base level)
+	GLenum filter;			///< Filter used when the texture is sampled
+	int bytes;				///< Size of one texel in bytes (for the memory statistics)
+	bool clear;				///< True to clear the texture before it is written first in the frame
+	GLfloat clearValue[4];	///< Color (or depth in the first value) the texture is cleared with
+};
+
+/**
+* Pass of the frame graph. Only its drawing is implemented, the frame buffer
+* with its attachments is bound and cleared by the graph before.
+*/
+class FrameGraphPass
+{
+public:
+	virtual ~FrameGraphPass() {}
+
+	/**
+	* Draw the pass.
+	* @param graph - the graph executing the pass
+	*/
+	virtual void Execute(FrameGraph * graph) = 0;
+};
+
+class FrameGraph
+{
+public:
+	/**
+	* Simple constructor and destructor
+	* @param pool - the pool transient textures are taken from (and given back to when the graph is deleted)
+	*/
+	FrameGraph(RenderTargetPool * pool);
+	~FrameGraph();
+
+	/**
+	* Declare the texture created by the graph only for the time it is used in the frame.
+	* @param name	- Name of the texture
+	* @param desc	- Description of the texture
+	* @return Index of the texture resource
+	*/
+	int CreateTexture(const char *name, const FrameGraphTextureDesc &desc);
+
+	/**
+	* Declare the texture created outside of the graph (it lives all the time).
+	* @param name		- Name of the texture
+	* @param texture	- Handler of the texture (0 for the screen)
+	* @param desc		- Description of the texture
+	* @return Index of the texture resource
+	*/
+	int ImportTexture(const char *name, GLuint texture, const FrameGraphTextureDesc &desc);
+
+	/**
+	* Add the pass. Passes are ordered by textures they read and write, passes
+	* not depending on each other stay in the order they were added.
+	* @param name	- Name of the pass (also the name of its profiler section)
+	* @param pass	- The pass (the graph deletes it)
+	* @return Index of the pass
+	*/
+	int AddPass(const char *name, FrameGraphPass * pass);
+
+	/**
+	* Declare the texture the pass reads (samples).
+	* @param pass		- Index of the pass
+	* @param resource	- Index of the texture
+	*/
+	void Read(int pass, int resource);
+
+	/**
+	* Declare the texture the pass writes by itself, without the frame buffer of the graph.
+	* @param pass		- Index of the pass
+	* @param resource	- Index of the texture
+	*/
+	void Write(int pass, int resource);
+
+	/**
+	* Declare the texture the pass renders to. Color textures are attached in the order of
+	* declaring them, the depth texture to the depth attachment.
+	* @param pass		- Index of the pass
+	* @param resource	- Index of the texture
+	* @param clear		- False when the pass writes every texel itself, so it doesn't have to be cleared
+	*/
+	void Attach(int pass, int resource, bool clear = true);
+
+	/**
+	* Mark the texture as the output of the frame. Passes not leading to any output are culled.
+	* @param resource - Index of the texture
+	*/
+	void SetOutput(int resource);
+
+	/**
+	* Cull, order and allocate everything declared so far. Run it once before executing.
+	*/
+	void Compile();
+
+	/**
+	* Execute all passes in the compiled order, each in its own profiler section.
+	*/
+	void Execute();
+
+	/**
+	* Print the compiled passes and the memory of transient textures.
+	*/
+	void Dump();
+
+	/**
+	* Get the texture handler of the resource (valid after compiling).
+	* @param resource - Index of the texture
+	* @return Handler of the texture
+	*/
+	GLuint GetTexture(int resource);
+
+	/**
+	* Get the memory taken by textures taken by the graph.
+	* @return Memory in megabytes
+	*/
+	GLfloat GetTransientMegabytes();
+
+private:
+
+	/**
+	* Texture declared in the graph.
+	*/
+	struct Resource
+	{
+		std::string name;			///< Name of the texture
+		FrameGraphTextureDesc desc;	///< Description of the texture
+		bool transient;				///< True when the graph creates the texture
+		GLuint texture;				///< Handler of the texture
+		int physical;				///< Index of the created texture (transient only, -1 when not used)
+		int firstUse;				///< Position of the first pass using it in the compiled order
+		int lastUse;				///< Position of the last pass using it in the compiled order
+	};
+
+	/**
+	* Texture taken by the graph, shared by transients with the same description.
+	*/
+	struct Physical
+	{
+		FrameGraphTextureDesc desc;	///< Description of the texture
+		GLuint texture;				///< Handler of the texture
+		int freeAfter;				///< Position of the pass after which the texture is not used any more
+	};
+
+	/**
+	* Pass declared in the graph.
+	*/
+	struct Pass
+	{
+		std::string name;				///< Name of the pass
+		FrameGraphPass * pass;			///< The pass drawing
+		std::vector<int> reads;			///< Textures read by the pass
+		std::vector<int> writes;		///< Textures written by the pass by itself
+		std::vector<int> attachments;	///< Textures rendered to (color ones first in order, then depth)
+		std::vector<bool> clears;		///< True when the attachment is cleared (may be, until compiled)
+		GLuint frameBuffer;				///< Frame buffer with attachments (0 when the pass binds its own)
+		bool culled;					///< True when the pass doesn't lead to any output
+	};
+
+	/**
+	* Check if the pass writes the texture (by itself or as the attachment).
+	* @param pass		- The pass
+	* @param resource	- Index of the texture
+	* @return True when it writes it
+	*/
+	bool Writes(const Pass &pass, int resource);
+
+	/**
+	* Check if the texture has a depth format.
+	* @param resource - Index of the texture
+	* @return True for the depth texture
+	*/
+	bool IsDepth(int resource);
+
+	RenderTargetPool * pool;			///< The pool transient textures are taken from
+	std::vector<Resource> resources;	///< All declared textures
+	std::vector<Physical> physicals;	///< All textures taken by the graph
+	std::vector<Pass> passes;			///< All declared passes
+	std::vector<int> order;				///< Indices of not culled passes in the order of executing
+	std::vector<int> outputs;			///< Textures that are outputs of the frame
+	std::vector<GLuint> frameBuffers;	///< All frame buffers made by the graph
+};
@@ -0,0 +1,356 @@
+/**
+* GL state cache helper library.
+*
+* Simple static library shadowing the opengl state that is changed for every
+* draw (the program, the vertex array, frame buffers, textures of texture units,
+* uniform buffers, the viewport and the clear color). Calls setting the state
+* that is already set are skipped and counted.
+*
+* (c) 2014 Damian Nowakowski
+*/
+
+
+#include "GLState.h"
+#include "Engine.h"
+#include "Profiler.h"
+
+// The handler no object can have, remembered when the state is not known.
+#define GLSTATE_UNKNOWN 0xFFFFFFFF
+
+bool GLState::enabled = true;
+GLuint GLState::program = GLSTATE_UNKNOWN;
+GLuint GLState::vertexArray = GLSTATE_UNKNOWN;
+GLuint GLState::drawFrameBuffer = GLSTATE_UNKNOWN;
+GLuint GLState::readFrameBuffer = GLSTATE_UNKNOWN;
+GLuint GLState::activeUnit = GLSTATE_UNKNOWN;
+GLuint GLState::textures[GLSTATE_TEXTURE_UNITS][2];
+GLuint GLState::uniformBuffer = GLSTATE_UNKNOWN;
+GLuint GLState::uniformBuffers[GLSTATE_UNIFORM_BINDINGS];
+GLint GLState::viewport[4];
+GLfloat GLState::clearColor[4];
+bool GLState::viewportKnown = false;
+bool GLState::clearColorKnown = false;
+int GLState::issuedCalls = 0;
+int GLState::elidedCalls = 0;
+
+/**
+* Read from the configuration ini file if calls are skipped and forget the remembered state.
+* Use it once after the opengl context is made.
+*/
+void GLState::Init()
+{
+	enabled = ENGINE->config->GetBoolean("Render", "StateCache", true);
+	Reset();
+}
+
+/**
+* Forget the remembered state, so every next call goes to opengl. Use it after the state was
+* changed without this library.
+*/
+void GLState::Reset()
+{
+	program = vertexArray = GLSTATE_UNKNOWN;
+	drawFrameBuffer = readFrameBuffer = GLSTATE_UNKNOWN;
+	activeUnit = GLSTATE_UNKNOWN;
+	for (int i = 0; i < GLSTATE_TEXTURE_UNITS; i++)
+	{
+		textures[i][0] = textures[i][1] = GLSTATE_UNKNOWN;
+	}
+	uniformBuffer = GLSTATE_UNKNOWN;
+	for (int i = 0; i < GLSTATE_UNIFORM_BINDINGS; i++)
+	{
+		uniformBuffers[i] = GLSTATE_UNKNOWN;
+	}
+	viewportKnown = clearColorKnown = false;
+}
+
+/**
+* Add counters of calls that went to opengl and calls that were skipped in this frame
+* to the profiler and start counting again.
+*/
+void GLState::ReportStatistics()
+{
+	ENGINE->profiler->AddCounter("GL state calls", issuedCalls);
+	ENGINE->profiler->AddCounter("GL state calls skipped", elidedCalls);
+	issuedCalls = 0;
+	elidedCalls = 0;
+}
+
+/**
+* Count the call and tell if it has to go to opengl.
+* @param changed - True when the call changes the remembered state
+* @returns true if the call has to go to opengl
+*/
+bool GLState::Issue(bool changed)
+{
+	if (changed || enabled == false)
+	{
+		issuedCalls++;
+		return true;
+	}
+	elidedCalls++;
+	return false;
+}
+
+/**
+* Use the program (like glUseProgram).
+* @param newProgram - Handler of the program
+*/
+void GLState::UseProgram(GLuint newProgram)
+{
+	if (Issue(program != newProgram))
+	{
+		glUseProgram(newProgram);
+		program = newProgram;
+	}
+}
+
+/**
+* Bind the vertex array (like glBindVertexArray).
+* @param newVertexArray - Handler of the vertex array
+*/
+void GLState::BindVertexArray(GLuint newVertexArray)
+{
+	if (Issue(vertexArray != newVertexArray))
+	{
+		glBindVertexArray(newVertexArray);
+		vertexArray = newVertexArray;
+	}
+}
+
+/**
+* Bind the frame buffer (like glBindFramebuffer). GL_FRAMEBUFFER binds it for both drawing and reading.
+* @param target			- GL_DRAW_FRAMEBUFFER, GL_READ_FRAMEBUFFER or GL_FRAMEBUFFER
+* @param frameBuffer	- Handler of the frame buffer
+*/
+void GLState::BindFramebuffer(GLenum target, GLuint frameBuffer)
+{
+	bool draw = (target != GL_READ_FRAMEBUFFER);
+	bool read = (target != GL_DRAW_FRAMEBUFFER);
+	bool changed = (draw && drawFrameBuffer != frameBuffer) || (read && readFrameBuffer != frameBuffer);
+	if (Issue(changed))
+	{
+		glBindFramebuffer(target, frameBuffer);
+		if (draw)
+		{
+			drawFrameBuffer = frameBuffer;
+		}
+		if (read)
+		{
+			readFrameBuffer = frameBuffer;
+		}
+	}
+}
+
+/**
+* Make the texture unit active (like glActiveTexture).
+* @param unit - GL_TEXTURE0 and next ones
+*/
+void GLState::ActiveTexture(GLenum unit)
+{
+	GLuint newUnit = unit - GL_TEXTURE0;
+	if (Issue(activeUnit != newUnit))
+	{
+		glActiveTexture(unit);
+		activeUnit = newUnit;
+	}
+}
+
+/**
+* Bind the texture to the active texture unit (like glBindTexture). Only simple and array textures
+* are remembered, other targets always go to opengl.
+* @param target		- Target of the texture
+* @param texture	- Handler of the texture
+*/
+void GLState::BindTexture(GLenum target, GLuint texture)
+{
+	int index = -1;
+	if (target == GL_TEXTURE_2D)		index = 0;
+	if (target == GL_TEXTURE_2D_ARRAY)	index = 1;
+	if (index < 0 || activeUnit >= GLSTATE_TEXTURE_UNITS)
+	{
+		Issue(true);
+		glBindTexture(target, texture);
+		return;
+	}
+
+	if (Issue(textures[activeUnit][index] != texture))
+	{
+		glBindTexture(target, texture);
+		textures[activeUnit][index] = texture;
+	}
+}
+
+/**
+* Bind the buffer to the target (like glBindBuffer). Only the uniform buffer target is remembered,
+* other targets always go to opengl.
+* @param target - Target of the buffer
+* @param buffer - Handler of the buffer
+*/
+void GLState::BindBuffer(GLenum target, GLuint buffer)
+{
+	if (target != GL_UNIFORM_BUFFER)
+	{
+		Issue(true);
+		glBindBuffer(target, buffer);
+		return;
+	}
+
+	if (Issue(uniformBuffer != buffer))
+	{
+		glBindBuffer(target, buffer);
+		uniformBuffer = buffer;
+	}
+}
+
+/**
+* Bind the buffer to the binding point (like glBindBufferBase). It binds it to the target too,
+* so it is skipped only when the buffer is already bound to both. Only uniform buffers are remembered,
+* other targets always go to opengl.
+* @param target - Target of the buffer
+* @param index	- Index of the binding point
+* @param buffer - Handler of the buffer
+*/
+void GLState::BindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+	if (target != GL_UNIFORM_BUFFER || index >= GLSTATE_UNIFORM_BINDINGS)
+	{
+		Issue(true);
+		glBindBufferBase(target, index, buffer);
+		return;
+	}
+
+	if (Issue(uniformBuffers[index] != buffer || uniformBuffer != buffer))
+	{
+		glBindBufferBase(target, index, buffer);
+		uniformBuffers[index] = buffer;
+		uniformBuffer = buffer;
+	}
+}
+
+/**
+* Set the viewport (like glViewport).
+* @param x		- Left edge of the viewport
+* @param y		- Bottom edge of the viewport
+* @param width	- Width of the viewport
+* @param height	- Height of the viewport
+*/
+void GLState::Viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	bool changed = viewportKnown == false || viewport[0] != x || viewport[1] != y || viewport[2] != width || viewport[3] != height;
+	if (Issue(changed))
+	{
+		glViewport(x, y, width, height);
+		viewport[0] = x;
+		viewport[1] = y;
+		viewport[2] = width;
+		viewport[3] = height;
+		viewportKnown = true;
+	}
+}
+
+/**
+* Set the clear color (like glClearColor).
+* @param red	- Red component of the color
+* @param green	- Green component of the color
+* @param blue	- Blue component of the color
+* @param alpha	- Alpha component of the color
+*/
+void GLState::ClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+{
+	bool changed = clearColorKnown == false || clearColor[0] != red || clearColor[1] != green || clearColor[2] != blue || clearColor[3] != alpha;
+	if (Issue(changed))
+	{
+		glClearColor(red, green, blue, alpha);
+		clearColor[0] = red;
+		clearColor[1] = green;
+		clearColor[2] = blue;
+		clearColor[3] = alpha;
+		clearColorKnown = true;
+	}
+}
+
+/**
+* Delete textures (like glDeleteTextures). Opengl unbinds them, so they are forgotten where they were bound.
+* @param count			- Number of textures
+* @param deletedTextures	- Handlers of textures
+*/
+void GLState::DeleteTextures(GLsizei count, const GLuint *deletedTextures)
+{
+	for (int i = 0; i < count; i++)
+	{
+		for (int unit = 0; unit < GLSTATE_TEXTURE_UNITS; unit++)
+		{
+			for (int index = 0; index < 2; index++)
+			{
+				if (deletedTextures[i] != 0 && textures[unit][index] == deletedTextures[i])
+				{
+					textures[unit][index] = GLSTATE_UNKNOWN;
+				}
+			}
+		}
+	}
+	glDeleteTextures(count, deletedTextures);
+}
+
+/**
+* Delete frame buffers (like glDeleteFramebuffers). Opengl unbinds them, so they are forgotten where they were bound.
+* @param count			- Number of frame buffers
+* @param frameBuffers	- Handlers of frame buffers
+*/
+void GLState::DeleteFramebuffers(GLsizei count, const GLuint *frameBuffers)
+{
+	for (int i = 0; i < count; i++)
+	{
+		if (frameBuffers[i] != 0 && drawFrameBuffer == frameBuffers[i])
+		{
+			drawFrameBuffer = GLSTATE_UNKNOWN;
+		}
+		if (frameBuffers[i] != 0 && readFrameBuffer == frameBuffers[i])
+		{
+			readFrameBuffer = GLSTATE_UNKNOWN;
+		}
+	}
+	glDeleteFramebuffers(count, frameBuffers);
+}
+
+/**
+* Delete buffers (like glDeleteBuffers). Opengl unbinds them, so they are forgotten where they were bound.
+* @param count		- Number of buffers
+* @param buffers	- Handlers of buffers
+*/
+void GLState::DeleteBuffers(GLsizei count, const GLuint *buffers)
+{
+	for (int i = 0; i < count; i++)
+	{
+		if (buffers[i] != 0 && uniformBuffer == buffers[i])
+		{
+			uniformBuffer = GLSTATE_UNKNOWN;
+		}
+		for (int index = 0; index < GLSTATE_UNIFORM_BINDINGS; index++)
+		{
+			if (buffers[i] != 0 && uniformBuffers[index] == buffers[i])
+			{
+				uniformBuffers[index] = GLSTATE_UNKNOWN;
+			}
+		}
+	}
+	glDeleteBuffers(count, buffers);
+}
+
+/**
+* Delete vertex arrays (like glDeleteVertexArrays). Opengl unbinds them, so they are forgotten where they were bound.
+* @param count			- Number of vertex arrays
+* @param vertexArrays	- Handlers of vertex arrays
+*/
+void GLState::DeleteVertexArrays(GLsizei count, const GLuint *vertexArrays)
+{
+	for (int i = 0; i < count; i++)
+	{
+		if (vertexArrays[i] != 0 && vertexArray == vertexArrays[i])
+		{
+			vertexArray = GLSTATE_UNKNOWN;
+		}
+	}
+	glDeleteVertexArrays(count, vertexArrays);
+}
@@ -0,0 +1,168 @@
+/**
+* GL state cache helper library.
+*
+* Simple static library shadowing the opengl state that is changed for every
+* draw (the program, the vertex array, frame buffers, textures of texture units,
+* uniform buffers, the viewport and the clear color). Calls setting the state
+* that is already set are skipped and counted.
+*
+* (c) 2014 Damian Nowakowski
+*/
+
+
+#pragma once
+
+#include <GL/glew.h>
+
+// Define the number of texture units and uniform buffer bindings whose state is remembered
+#define GLSTATE_TEXTURE_UNITS 16
+#define GLSTATE_UNIFORM_BINDINGS 8
+
+class GLState
+{
+public:
+	/**
+	* Read from the configuration ini file if calls are skipped and forget the remembered state.
+	* Use it once after the opengl context is made.
+	*/
+	static void Init();
+
+	/**
+	* Forget the remembered state, so every next call goes to opengl. Use it after the state was
+	* changed without this library.
+	*/
+	static void Reset();
+
+	/**
+	* Add counters of calls that went to opengl and calls that were skipped in this frame
+	* to the profiler and start counting again.
+	*/
+	static void ReportStatistics();
+
+	/// Functions below work the same as opengl functions with the same name,
+	/// but do nothing when the state is already set. Objects that can be bound are deleted
+	/// with them too, so handlers opengl gives again are not taken for still bound ones.
+
+	/**
+	* Use the program (like glUseProgram).
+	* @param newProgram - Handler of the program
+	*/
+	static void UseProgram(GLuint newProgram);
+
+	/**
+	* Bind the vertex array (like glBindVertexArray).
+	* @param newVertexArray - Handler of the vertex array
+	*/
+	static void BindVertexArray(GLuint newVertexArray);
+
+	/**
+	* Bind the frame buffer (like glBindFramebuffer). GL_FRAMEBUFFER binds it for both drawing and reading.
+	* @param target			- GL_DRAW_FRAMEBUFFER, GL_READ_FRAMEBUFFER or GL_FRAMEBUFFER
+	* @param frameBuffer	- Handler of the frame buffer
+	*/
+	static void BindFramebuffer(GLenum target, GLuint frameBuffer);
+
+	/**
+	* Make the texture unit active (like glActiveTexture).
+	* @param unit - GL_TEXTURE0 and next ones
+	*/
+	static void ActiveTexture(GLenum unit);
+
+	/**
+	* Bind the texture to the active texture unit (like glBindTexture). Only simple and array textures
+	* are remembered, other targets always go to opengl.
+	* @param target		- Target of the texture
+	* @param texture	- Handler of the texture
+	*/
+	static void BindTexture(GLenum target, GLuint texture);
+
+	/**
+	* Bind the buffer to the target (like glBindBuffer). Only the uniform buffer target is remembered,
+	* other targets always go to opengl.
+	* @param target - Target of the buffer
+	* @param buffer - Handler of the buffer
+	*/
+	static void BindBuffer(GLenum target, GLuint buffer);
+
+	/**
+	* Bind the buffer to the binding point (like glBindBufferBase). It binds it to the target too,
+	* so it is skipped only when the buffer is already bound to both. Only uniform buffers are remembered,
+	* other targets always go to opengl.
+	* @param target - Target of the buffer
+	* @param index	- Index of the binding point
+	* @param buffer - Handler of the buffer
+	*/
+	static void BindBufferBase(GLenum target, GLuint index, GLuint buffer);
+
+	/**
+	* Set the viewport (like glViewport).
+	* @param x		- Left edge of the viewport
+	* @param y		- Bottom edge of the viewport
+	* @param width	- Width of the viewport
+	* @param height	- Height of the viewport
+	*/
+	static void Viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+	/**
+	* Delete textures (like glDeleteTextures). Opengl unbinds them, so they are forgotten where they were bound.
+	* @param count			- Number of textures
+	* @param deletedTextures	- Handlers of textures
+	*/
+	static void DeleteTextures(GLsizei count, const GLuint *deletedTextures);
+
+	/**
+	* Delete frame buffers (like glDeleteFramebuffers). Opengl unbinds them, so they are forgotten where they were bound.
+	* @param count			- Number of frame buffers
+	* @param frameBuffers	- Handlers of frame buffers
+	*/
+	static void DeleteFramebuffers(GLsizei count, const GLuint *frameBuffers);
+
+	/**
+	* Delete buffers (like glDeleteBuffers). Opengl unbinds them, so they are forgotten where they were bound.
+	* @param count		- Number of buffers
+	* @param buffers	- Handlers of buffers
+	*/
+	static void DeleteBuffers(GLsizei count, const GLuint *buffers);
+
+	/**
+	* Delete vertex arrays (like glDeleteVertexArrays). Opengl unbinds them, so they are forgotten where they were bound.
+	* @param count			- Number of vertex arrays
+	* @param vertexArrays	- Handlers of vertex arrays
+	*/
+	static void DeleteVertexArrays(GLsizei count, const GLuint *vertexArrays);
+
+	/**
+	* Set the clear color (like glClearColor).
+	* @param red	- Red component of the color
+	* @param green	- Green component of the color
+	* @param blue	- Blue component of the color
+	* @param alpha	- Alpha component of the color
+	*/
+	static void ClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
+
+private:
+	/**
+	* Count the call and tell if it has to go to opengl.
+	* @param changed - True when the call changes the remembered state
+	* @returns true if the call has to go to opengl
+	*/
+	static bool Issue(bool changed);
+
+	static bool enabled;										///< True when calls setting the same state are skipped
+
+	static GLuint program;										///< Program in use
+	static GLuint vertexArray;									///< Bound vertex array
+	static GLuint drawFrameBuffer;								///< Frame buffer bound for drawing
+	static GLuint readFrameBuffer;								///< Frame buffer bound for reading
+	static GLuint activeUnit;									///< Index of the active texture unit
+	static GLuint textures[GLSTATE_TEXTURE_UNITS][2];			///< Simple and array textures bound to every texture unit
+	static GLuint uniformBuffer;								///< Buffer bound to the uniform buffer target
+	static GLuint uniformBuffers[GLSTATE_UNIFORM_BINDINGS];		///< Buffers bound to uniform buffer binding points
+	static GLint viewport[4];									///< Position and size of the viewport
+	static GLfloat clearColor[4];								///< Clear color
+	static bool viewportKnown;									///< True when the viewport is remembered
+	static bool clearColorKnown;								///< True when the clear color is remembered
+
+	static int issuedCalls;										///< Number of calls that went to opengl in this frame
+	static int elidedCalls;										///< Number of calls skipped in this frame
+};
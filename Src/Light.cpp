@@ -9,6 +9,7 @@
 
 #include "Light.h"
 #include "Shaders.h"
+#include "GLState.h"
 #include "Engine.h"
 #include "Scene.h"
 #include "Window.h"
@@ -17,6 +18,10 @@
 #include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtc/type_ptr.hpp"
 
+// Set the default values of the shared marker shader, it is created with the first light
+GLuint Light::shader = 0;
+int Light::shaderUsers = 0;
+
 /**
  * Simple constructor with initialization
  */
@@ -57,11 +62,16 @@ Light::Light()
 	scale =			glm::vec2(	localINIReader->GetReal("Light", "Marker_Size_X", 1.0), 
 								ENGINE->scene->camera->GetRatio()*localINIReader->GetReal("Light", "Marker_Size_Y", 1.0));
 
-	/// Create the shader that will be used to render the light marker
-	Shaders::AttachShader(shader, GL_VERTEX_SHADER, "data/shaders/light_marker_vs.glsl");
-	Shaders::AttachShader(shader, GL_GEOMETRY_SHADER, "data/shaders/light_marker_gs.glsl");
-	Shaders::AttachShader(shader, GL_FRAGMENT_SHADER, "data/shaders/light_marker_fs.glsl");
-	Shaders::LinkProgram(shader);
+	/// Create the shader that will be used to render the light marker.
+	/// All lights draw markers the same way, so only the first one creates it.
+	if (shaderUsers == 0)
+	{
+		Shaders::AttachShader(shader, GL_VERTEX_SHADER, "data/shaders/light_marker_vs.glsl");
+		Shaders::AttachShader(shader, GL_GEOMETRY_SHADER, "data/shaders/light_marker_gs.glsl");
+		Shaders::AttachShader(shader, GL_FRAGMENT_SHADER, "data/shaders/light_marker_fs.glsl");
+		Shaders::LinkProgram(shader);
+	}
+	shaderUsers++;
 
 	// Remember the location of vertex position in shader program
 	vertex_loc = glGetAttribLocation(shader, "inPosition");
@@ -72,41 +82,65 @@ Light::Light()
 
 	/// Fill the buffer with the vertex data, that is a position of point light.
 	/// Only one point is needed, bedause the whole marker will be generated in geometry shader.
-	glBindVertexArray(VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	GLState::BindVertexArray(VAO);
+	GLState::BindBuffer(GL_ARRAY_BUFFER, VBO);
 
 		glVertexAttribPointer(vertex_loc, 3, GL_FLOAT, GL_FALSE, 0, NULL);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(position), glm::value_ptr(position), GL_STATIC_DRAW);
 		glEnableVertexAttribArray(vertex_loc);
 
-	glBindVertexArray(0);
+	GLState::BindVertexArray(0);
 
 	// Zero the movement direction
 	moveDir = glm::vec3(0);
 }
 
+/**
+ * Constructor of additional lights. All parameters except the position
+ * and the diffuse color are the same as in the configuration ini file.
+ * @param lightPosition	- Position of the point light
+ * @param color			- Diffuse color RGB of the light
+ */
+Light::Light(const glm::vec3 &lightPosition, const glm::vec3 &color) : Light()
+{
+	position = lightPosition;
+	diffuse[0] = color.r;
+	diffuse[1] = color.g;
+	diffuse[2] = color.b;
+
+	UpdateVertexBuffer();
+}
+
 /**
  * Draw the point light marker (to see where is the source)
+ * @param color - Color of the marker (NULL - the diffuse color of the light)
  */
-void Light::DrawTheMarker()
+void Light::DrawTheMarker(const GLfloat *color)
 {
 	// Get the view projection matrix from camera. It will be used for proper transformation of light position.
 	glm::mat4 viewProjectionMatrix	= ENGINE->scene->camera->GetViewProjectionMatrix();
 	
 	/// Draw the light marker using given view projection matrix, scale and the diffuse color of light.
 	/// We do not translate the position of light using the model matrix, because it has only position and it can
-	/// be pass originally.
-	glUseProgram(shader);
+	/// be pass originally. The program stays in use after drawing, so markers of other lights don't use it again.
+	GLState::UseProgram(shader);
 
 		glUniformMatrix4fv(glGetUniformLocation(shader, "viewProjectionMatrix"), 1, GL_FALSE, glm::value_ptr(viewProjectionMatrix));
 		glUniform2fv(glGetUniformLocation(shader, "scale"), 1, glm::value_ptr(scale));
-		glUniform4fv(glGetUniformLocation(shader, "color"), 1, diffuse);
+		glUniform4fv(glGetUniformLocation(shader, "color"), 1, (color != NULL) ? color : diffuse);
 
-		glBindVertexArray(VAO);
+		GLState::BindVertexArray(VAO);
 			glDrawArrays(GL_POINTS, 0, 1);
-		glBindVertexArray(0);
+}
 
-	glUseProgram(0);
+/**
+ * Get the scale of the marker. It is added to the light position after the projection,
+ * so the marker gets smaller with the distance.
+ * @returns the scale of the marker
+ */
+glm::vec2 Light::GetMarkerScale()
+{
+	return scale;
 }
 
 /**
@@ -118,11 +152,18 @@ void Light::Update(float deltaTime)
 	// Set the new position using the movement direction and the shift
 	position += (moveDir * moveSpeed * deltaTime);
 
-	/// Update the vertex buffer data with new position
-	glBindVertexArray(VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	UpdateVertexBuffer();
+}
+
+/**
+ * Fill the vertex buffer with the current position of the light.
+ */
+void Light::UpdateVertexBuffer()
+{
+	GLState::BindVertexArray(VAO);
+	GLState::BindBuffer(GL_ARRAY_BUFFER, VBO);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(position), glm::value_ptr(position), GL_STATIC_DRAW);
-	glBindVertexArray(0);
+	GLState::BindVertexArray(0);
 }
 
 /**
@@ -196,8 +237,14 @@ bool Light::HandleInput()
  */
 Light::~Light()
 {
-	Shaders::DeleteShaders(shader);
-	glDeleteProgram(shader);
-	glDeleteBuffers(1, &VBO);
-	glDeleteVertexArrays(1, &VAO);
+	// The last light deletes the shared marker shader.
+	shaderUsers--;
+	if (shaderUsers == 0)
+	{
+		Shaders::DeleteShaders(shader);
+		glDeleteProgram(shader);
+		shader = 0;
+	}
+	GLState::DeleteBuffers(1, &VBO);
+	GLState::DeleteVertexArrays(1, &VAO);
 }
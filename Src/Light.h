@@ -22,6 +22,14 @@ public:
 	Light();
 	~Light();
 
+	/**
+	 * Constructor of additional lights. All parameters except the position
+	 * and the diffuse color are the same as in the configuration ini file.
+	 * @param lightPosition	- Position of the point light
+	 * @param color			- Diffuse color RGB of the light
+	 */
+	Light(const glm::vec3 &lightPosition, const glm::vec3 &color);
+
 	glm::vec3 position;		///< Position of the point light
 
 	GLfloat diffuse[4];		///< Diffuse color RGBA of the light(in an array because of TweakBar compatibility)
@@ -32,8 +40,16 @@ public:
 
 	/**
 	 * Draw the point light marker (to see where is the source)
+	 * @param color - Color of the marker (NULL - the diffuse color of the light)
 	 */
-	void DrawTheMarker();
+	void DrawTheMarker(const GLfloat *color = NULL);
+
+	/**
+	 * Get the scale of the marker. It is added to the light position after the projection,
+	 * so the marker gets smaller with the distance.
+	 * @returns the scale of the marker
+	 */
+	glm::vec2 GetMarkerScale();
 
 	/**
 	 * Update the position and the color of the light
@@ -49,7 +65,13 @@ public:
 
 private:
 
-	GLuint shader;		///< Handler of the shader that draws light marker
+	/**
+	 * Fill the vertex buffer with the current position of the light.
+	 */
+	void UpdateVertexBuffer();
+
+	static GLuint shader;		///< Handler of the shader that draws light marker (shared by all lights)
+	static int shaderUsers;		///< Number of lights using the marker shader
 
 	GLuint VAO;			///< Vertex array object needed for shader
 	GLuint VBO;			///< Vertex buffer object needed for shader
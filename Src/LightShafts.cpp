@@ -8,12 +8,19 @@
 * (c) 2014 Damian Nowakowski
 */
 
+#include <cstddef>
 #include "LightShafts.h"
 #include "Shaders.h"
+#include "GLState.h"
+#include "BlueNoise.h"
 #include "Scene.h"
 #include "Camera.h"
 #include "Light.h"
+#include "Profiler.h"
+#include "FrameGraph.h"
+#include "RenderTargetPool.h"
 #include "glm/gtc/type_ptr.hpp"
+#include "glm/gtc/constants.hpp"
 
 ///< Vertex coordinates of final scene (quad filling whole screen)
 GLfloat rect[12] =
@@ -39,6 +46,64 @@ GLfloat texcoords[12] =
 	0.0f, 1.0f
 };
 
+///< Formats of the normal scene color
+const ShaftsFormat colorFormats[] =
+{
+	{ "RGBA8",		GL_RGBA8,			4 },
+	{ "RGB10A2",	GL_RGB10_A2,		4 },
+	{ "R11G11B10F",	GL_R11F_G11F_B10F,	4 },
+	{ "RGBA16F",	GL_RGBA16F,			8 }
+};
+
+///< Formats of the occlusion (it has a single channel)
+const ShaftsFormat occlusionFormats[] =
+{
+	{ "R8",		GL_R8,		1 },
+	{ "R16",	GL_R16,		2 },
+	{ "R16F",	GL_R16F,	2 },
+	{ "R32F",	GL_R32F,	4 }
+};
+
+///< Formats of the depth (24 bits are padded to 32)
+const ShaftsFormat depthFormats[] =
+{
+	{ "DEPTH24",	GL_DEPTH_COMPONENT24,	4 },
+	{ "DEPTH32F",	GL_DEPTH_COMPONENT32F,	4 }
+};
+
+/**
+* Find the format of the given name. When there is no such format the first one is used.
+* @param formats	- Array of available formats
+* @param count		- Number of available formats
+* @param name		- Name of the format from the configuration
+* @returns the found format
+*/
+const ShaftsFormat *FindFormat(const ShaftsFormat *formats, int count, const std::string &name)
+{
+	for (int i = 0; i < count; i++)
+	{
+		if (name == formats[i].name)
+		{
+			return &formats[i];
+		}
+	}
+	printf("Unknown render target format %s, using %s instead.\n", name.c_str(), formats[0].name);
+	return &formats[0];
+}
+
+/**
+* Data of the uniform buffer with many lights. It is the std140 layout of ShaftsLights block in shaders.
+*/
+struct ShaftsLightsData
+{
+	glm::vec4 positions[SHAFTS_MAX_LIGHTS];	///< Positions of lights on screen in (0,1) coordinates (xy)
+	glm::vec4 colors[SHAFTS_MAX_LIGHTS];	///< Colors of lights scaled by their intensity (rgb)
+	glm::vec4 markers[SHAFTS_MAX_LIGHTS];	///< Discs of light markers on screen (xy - radius in (0,1) coordinates, z - depth)
+	GLint count;							///< Number of lights
+	GLint samples;							///< Number of samples of every light
+	GLint padding[2];						///< The block size is rounded up to the vec4 size
+};
+
 /**
 * Simple constructor with initialization
 */
@@ -55,43 +120,162 @@ LightShafts::LightShafts()
 	weight			= (GLfloat)localINIReader->GetReal("Shafts", "Weight", 0);
 	samples			= localINIReader->GetInteger("Shafts", "Samples", 0);
 
-	// Remember the camera from scene so we can use it in the future
-	Camera * localCamera = ENGINE->scene->camera;
+	/// Remember the method of rendering light shafts and its parameters
+	std::string modeName	= localINIReader->Get("Shafts", "Mode", "Radial");
+	mode					= SHAFTS_MODE_RADIAL;
+	if (modeName == "Epipolar")		mode = SHAFTS_MODE_EPIPOLAR;
+	if (modeName == "Hierarchical")	mode = SHAFTS_MODE_HIERARCHICAL;
+	if (modeName == "Polar")		mode = SHAFTS_MODE_POLAR;
+	if (modeName == "Compute")		mode = SHAFTS_MODE_COMPUTE;
+	if (modeName == "Temporal")		mode = SHAFTS_MODE_TEMPORAL;
+	if (modeName == "Cone")			mode = SHAFTS_MODE_CONE;
+	if (modeName == "Bitmask")		mode = SHAFTS_MODE_BITMASK;
+	if (modeName == "Skip")			mode = SHAFTS_MODE_SKIP;
+	if (modeName == "Adaptive")		mode = SHAFTS_MODE_ADAPTIVE;
+	offscreenFadeDistance	= (GLfloat)localINIReader->GetReal("Shafts", "OffscreenFadeDistance", 0.5);
+	occlusionQuery			= localINIReader->GetBoolean("Shafts", "OcclusionQuery", true);
+	occlusionFade			= localINIReader->GetBoolean("Shafts", "OcclusionFade", false);
+	epipolarLines			= localINIReader->GetInteger("Shafts", "EpipolarLines", 512);
+	epipolarSamples			= localINIReader->GetInteger("Shafts", "EpipolarSamples", 256);
+	epipolarDepthThreshold	= (GLfloat)localINIReader->GetReal("Shafts", "EpipolarDepthThreshold", 0.1);
+	downsample				= glm::max(1, (int)localINIReader->GetInteger("Shafts", "Downsample", 1));
+	downsampleDepthSigma	= (GLfloat)localINIReader->GetReal("Shafts", "DownsampleDepthSigma", 0.05);
+	hierarchicalPasses		= glm::max(1, (int)localINIReader->GetInteger("Shafts", "HierarchicalPasses", 3));
+	hierarchicalTaps		= glm::max(2, (int)localINIReader->GetInteger("Shafts", "HierarchicalTaps", 8));
+	polarAngles				= glm::max(1, (int)localINIReader->GetInteger("Shafts", "PolarAngles", 1024));
+	polarRadii				= glm::max(2, (int)localINIReader->GetInteger("Shafts", "PolarRadii", 1024));
+	temporalFrames			= glm::max(1, (int)localINIReader->GetInteger("Shafts", "TemporalFrames", 4));
+	temporalMaxAge			= glm::max(1.0f, (GLfloat)localINIReader->GetReal("Shafts", "TemporalMaxAge", 16));
+	temporalLightThreshold	= (GLfloat)localINIReader->GetReal("Shafts", "TemporalLightThreshold", 0.01);
+	temporalDepthThreshold	= (GLfloat)localINIReader->GetReal("Shafts", "TemporalDepthThreshold", 0.1);
+	quality					= (localINIReader->Get("Shafts", "Quality", "High") == "Low") ? SHAFTS_QUALITY_LOW : SHAFTS_QUALITY_HIGH;
+	noiseSamples			= glm::max(1, (int)localINIReader->GetInteger("Shafts", "NoiseSamples", 16));
+	denoiseRadius			= glm::max(0, (int)localINIReader->GetInteger("Shafts", "DenoiseRadius", 4));
+	denoiseDepthSigma		= (GLfloat)localINIReader->GetReal("Shafts", "DenoiseDepthSigma", 0.05);
+	lightCullThreshold		= (GLfloat)localINIReader->GetReal("Shafts", "LightCullThreshold", 0.01);
+	minLightSamples			= glm::max(1, (int)localINIReader->GetInteger("Shafts", "MinLightSamples", 16));
+	coneSamples				= glm::max(1, (int)localINIReader->GetInteger("Shafts", "ConeSamples", 24));
+	coneLodBias				= (GLfloat)localINIReader->GetReal("Shafts", "ConeLodBias", 0);
+	occlusionDownsample		= glm::max(1, (int)localINIReader->GetInteger("Shafts", "OcclusionDownsample", 1));
+	skipValidate			= localINIReader->GetBoolean("Shafts", "SkipValidate", false);
+	tileClassification		= localINIReader->GetBoolean("Shafts", "TileClassification", false);
+	adaptiveMinSamples		= glm::max(1, (int)localINIReader->GetInteger("Shafts", "AdaptiveMinSamples", 8));
+	adaptiveEpsilon			= glm::max(0.0f, (GLfloat)localINIReader->GetReal("Shafts", "AdaptiveEpsilon", 0.002));
+	dither					= localINIReader->GetBoolean("Shafts", "Dither", false);
+	singlePass				= localINIReader->GetBoolean("Shafts", "SinglePass", false);
+	depthOcclusion			= (localINIReader->Get("Shafts", "OcclusionSource", "Geometry") == "Depth");
 
-	// Generate texture handlers for color and depth components
-	glGenTextures(1, &renderTextureArrayColor);
-	glGenTextures(1, &renderTextureArrayDepth);
+	// Remember formats of render targets.
+	int occlusionFormatsCount = sizeof(occlusionFormats) / sizeof(occlusionFormats[0]);
+	colorTargetFormat		= FindFormat(colorFormats, sizeof(colorFormats) / sizeof(colorFormats[0]), localINIReader->Get("Shafts", "ColorFormat", "RGBA8"));
+	occlusionTargetFormat	= FindFormat(occlusionFormats, occlusionFormatsCount, localINIReader->Get("Shafts", "OcclusionFormat", "R8"));
+	depthTargetFormat		= FindFormat(depthFormats, sizeof(depthFormats) / sizeof(depthFormats[0]), localINIReader->Get("Shafts", "DepthFormat", "DEPTH24"));
 
-	// Make a texture array for color component. This is where occlusion and scenes will be rendered to.
-	glBindTexture(GL_TEXTURE_2D_ARRAY, renderTextureArrayColor);
-	glTexParameterf(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, localCamera->renderWidth, localCamera->renderHeight, 2, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	// Polar, compute and bitmask modes need compute shaders, so go back to the radial blur when they are not supported.
+	if ((mode == SHAFTS_MODE_POLAR || mode == SHAFTS_MODE_COMPUTE || mode == SHAFTS_MODE_BITMASK) && !GLEW_VERSION_4_3)
+	{
+		printf("%s light shafts need OpenGL 4.3, using radial blur instead.\n", modeName.c_str());
+		mode = SHAFTS_MODE_RADIAL;
+	}
 
-	// Make a texture array for depth component. This is where occlusion and scenes depth buffer will be rendered to.
-	glBindTexture(GL_TEXTURE_2D_ARRAY, renderTextureArrayDepth);
-	glTexParameterf(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT, localCamera->renderWidth, localCamera->renderHeight, 2, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	// Tiles are classified in compute shaders, so calculate light shafts everywhere when they are not supported.
+	if (tileClassification && !GLEW_VERSION_4_3)
+	{
+		printf("Tile classification needs OpenGL 4.3, calculating light shafts on the whole screen.\n");
+		tileClassification = false;
+	}
 
+	/// The occlusion made from the depth doesn't draw the scene nor markers. Markers are not drawn, so their
+	/// samples can't be counted. The single pass is not needed, the scene is drawn once anyway.
+	if (depthOcclusion && occlusionQuery)
+	{
+		printf("The occlusion from depth doesn't draw light markers, so they are not counted.\n");
+		occlusionQuery = false;
+	}
+	if (depthOcclusion && singlePass)
+	{
+		printf("The occlusion from depth draws the scene only once, the single pass is not used.\n");
+		singlePass = false;
+	}
 
-	// Generate two frame buffers that will be used for rendering to textures
-	glGenFramebuffers(2, frameBuffers);
+	// Both attachments of the single pass are drawn with one viewport, so they must have the same size.
+	if (singlePass && occlusionDownsample > 1)
+	{
+		printf("The single pass needs the occlusion of the screen size, drawing the scene twice.\n");
+		singlePass = false;
+	}
 
-	// Bind first frame buffer to the first position of rexture array of color and depth. This is where occlusion will be rendered.
-	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, frameBuffers[0]);
-	glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, renderTextureArrayColor, 0, 0);
-	glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, renderTextureArrayDepth, 0, 0);
+	// Many lights are calculated together only with the radial blur.
+	if (ENGINE->scene->lights.size() > 1 && mode != SHAFTS_MODE_RADIAL)
+	{
+		printf("Many lights need radial light shafts, using radial blur instead of %s.\n", modeName.c_str());
+		mode = SHAFTS_MODE_RADIAL;
+	}
 
-	// Bind first frame buffer to the second position of rexture array of color and depth. This is where the normal scene will be rendered.
-	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, frameBuffers[1]);
-	glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, renderTextureArrayColor, 0, 1);
-	glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, renderTextureArrayDepth, 0, 1);
+	// Tiles are classified only for the radial blur.
+	tileClassification = tileClassification && mode == SHAFTS_MODE_RADIAL;
+
+	/// The color and the depth of the normal scene (and the depth of the occlusion) are only used inside
+	/// of the frame, so they are created by the frame graph (see DeclareTargets).
+	renderTextureArrayColor = renderTextureArrayDepth = normalFrameBuffer = 0;
+
+	// With many lights the back light is split between them and gets below 8 bits, so the occlusion needs more of them.
+	if (ENGINE->scene->lights.size() > 1 && occlusionTargetFormat->internalFormat == GL_R8)
+	{
+		printf("Many lights need more than 8 bits of the occlusion, using R16F instead.\n");
+		occlusionTargetFormat = FindFormat(occlusionFormats, occlusionFormatsCount, "R16F");
+	}
+	lightColor = glm::vec3(1);
+
+	/// Make render targets of the size of the screen. They are made again when the size changes,
+	/// everything else (textures of other sizes, buffers and shaders) stays.
+	CreateTargets();
+
+	// Make a texture for light shafts calculated along epipolar lines. Every row is one line
+	// and every column is one sample on it. Half floats are needed, because the alpha stores the depth.
+	epipolarTexture = epipolarFrameBuffer = 0;
+	if (mode == SHAFTS_MODE_EPIPOLAR)
+	{
+		CreateRenderTarget(epipolarTexture, epipolarFrameBuffer, GL_RGBA16F, epipolarSamples, epipolarLines, GL_NEAREST);
+	}
+
+	// Make textures for the occlusion and light scattering in polar coordinates. Every row is one direction
+	// from the light and every column is one distance. They are quite big, so make them only when needed.
+	polarTextures[0] = polarTextures[1] = 0;
+	polarFrameBuffer = 0;
+	if (mode == SHAFTS_MODE_POLAR)
+	{
+		CreateRenderTarget(polarTextures[0], polarFrameBuffer, GL_RGBA16F, polarRadii, polarAngles, GL_NEAREST);
+		CreateTexture(polarTextures[1], GL_RGBA16F, polarRadii, polarAngles, GL_LINEAR);
+
+		// Directions go around the light, so the last row is the neighbour of the first one.
+		GLState::BindTexture(GL_TEXTURE_2D, polarTextures[1]);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		GLState::BindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	// Make a texture with blue noise used to jitter the samples in low quality. It repeats over the screen.
+	const int noiseSize = 64;
+	std::vector<GLfloat> noise;
+	BlueNoise::Generate(noiseSize, noise);
+	glGenTextures(1, &noiseTexture);
+	GLState::BindTexture(GL_TEXTURE_2D, noiseTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, noiseSize, noiseSize, 0, GL_RED, GL_FLOAT, &noise[0]);
+	GLState::BindTexture(GL_TEXTURE_2D, 0);
+
+	// Generate queries counting samples of the light marker. There are two sets of them, so the
+	// results of the previous frame can be read while the current frame uses the other set.
+	glGenQueries(4, &markerQueries[0][0]);
+	markerQueryFrame = 0;
+	markerQueryIssued[0] = markerQueryIssued[1] = false;
+	markerVisibility = 1;
 
 	// Bind the basic frame buffer for now in order to not make a mess.
-	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	GLState::BindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
 
 	/// Create a shader for light shafts effect
 	Shaders::AttachShader(shader, GL_VERTEX_SHADER, "data/shaders/light_shafts_vs.glsl");
@@ -109,30 +293,30 @@ LightShafts::LightShafts()
 	glGenBuffers(1, &UBO);
 
 	/// Fill the buffer with the vertex data, that are positions of verticies of quad filling the whole screen.
-	glBindVertexArray(VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
+	GLState::BindVertexArray(VAO);
+	GLState::BindBuffer(GL_ARRAY_BUFFER, VBO[0]);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(rect), rect, GL_STATIC_DRAW);
 		glVertexAttribPointer(vertex_loc, 2, GL_FLOAT, GL_FALSE, 0, NULL);
 		glEnableVertexAttribArray(vertex_loc);
 
 	/// Fill the buffer with the texture coordinates data that are proper for quad filling the whole screen.
-	glBindBuffer(GL_ARRAY_BUFFER, VBO[1]);
+	GLState::BindBuffer(GL_ARRAY_BUFFER, VBO[1]);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(texcoords), texcoords, GL_STATIC_DRAW);
 		glVertexAttribPointer(texcoord_loc, 2, GL_FLOAT, GL_FALSE, 0, NULL);
 		glEnableVertexAttribArray(texcoord_loc);
 
-	glBindVertexArray(0);
+	GLState::BindVertexArray(0);
 
 	/// Declare the space in uniform buffer for shader where light shafts parameter are stored
 	/// Remember all parameters offsets so the uniform buffer can be easely fill after that.
-	glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+	GLState::BindBuffer(GL_UNIFORM_BUFFER, UBO);
 
 	// Get the needed size of uniform buffer (the size of data structure in shader)
 	GLint shaftsParamsSize;
 	glGetActiveUniformBlockiv(shader, shaftsParamsIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &shaftsParamsSize);
 	glBufferData(GL_UNIFORM_BUFFER, shaftsParamsSize, NULL, GL_DYNAMIC_DRAW);
 
-	glBindBufferBase(GL_UNIFORM_BUFFER, 0, UBO);
+	GLState::BindBufferBase(GL_UNIFORM_BUFFER, 0, UBO);
 	glUniformBlockBinding(shader, shaftsParamsIndex, 0);
 
 	// Prepare the array for parameters indices and helper array with parameters names
@@ -151,98 +335,1766 @@ LightShafts::LightShafts()
 	glGetActiveUniformsiv(shader, SHAFTS_UNIFORM_SIZE, uniformsIndex, GL_UNIFORM_OFFSET, uniformsOffset);
 
 	// Unbind the buffer object so program won't use them unnecessarily
-	glBindBufferBase(GL_UNIFORM_BUFFER, 0, 0);
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	GLState::BindBufferBase(GL_UNIFORM_BUFFER, 0, 0);
+	GLState::BindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	/// Create shaders for the radial blur specialized for the configured quality tier
+	SetQuality(quality);
+
+	/// Create shaders for light shafts calculated along epipolar lines
+	epipolarShader = epipolarCompositeShader = 0;
+	if (mode == SHAFTS_MODE_EPIPOLAR)
+	{
+		CreateQuadProgram(epipolarShader, "data/shaders/light_shafts_epipolar_fs.glsl");
+		CreateQuadProgram(epipolarCompositeShader, "data/shaders/light_shafts_epipolar_composite_fs.glsl");
+	}
+
+	/// Create a shader for upsampling light shafts calculated in lower resolution
+	CreateQuadProgram(upsampleShader, "data/shaders/light_shafts_upsample_fs.glsl");
+
+	/// Create a shader for denoising light shafts calculated with few samples
+	CreateQuadProgram(denoiseShader, "data/shaders/light_shafts_denoise_fs.glsl");
+
+	/// Create a shader for one pass of hierarchical radial blur
+	hierarchicalShader = 0;
+	if (mode == SHAFTS_MODE_HIERARCHICAL)
+	{
+		CreateQuadProgram(hierarchicalShader, "data/shaders/light_shafts_hierarchical_fs.glsl");
+	}
+
+	/// Create shaders for light shafts calculated in polar coordinates
+	polarWarpShader = polarScanShader = polarUnwarpShader = 0;
+	if (mode == SHAFTS_MODE_POLAR)
+	{
+		CreateQuadProgram(polarWarpShader, "data/shaders/light_shafts_polar_warp_fs.glsl");
+		CreateQuadProgram(polarUnwarpShader, "data/shaders/light_shafts_polar_unwarp_fs.glsl");
+		CreateComputeProgram(polarScanShader, "data/shaders/light_shafts_polar_scan_cs.glsl");
+	}
+
+	/// Create a shader for light shafts accumulated over frames
+	temporalShader = 0;
+	if (mode == SHAFTS_MODE_TEMPORAL)
+	{
+		CreateQuadProgram(temporalShader, "data/shaders/light_shafts_temporal_fs.glsl");
+	}
+
+	/// Create a shader for light shafts with taps reading the occlusion mipmaps
+	coneShader = 0;
+	if (mode == SHAFTS_MODE_CONE)
+	{
+		CreateQuadProgram(coneShader, "data/shaders/light_shafts_cone_fs.glsl");
+	}
+
+	// Generate timestamps comparing cone taps with the radial blur, they are used only with the profiler.
+	coneQueryNext = 0;
+	for (int i = 0; i < SHAFTS_CONE_QUERIES; i++)
+	{
+		coneQueryIssued[i] = false;
+	}
+	if (mode == SHAFTS_MODE_CONE && ENGINE->profiler->enabled)
+	{
+		glGenQueries(SHAFTS_CONE_QUERIES * 3, &coneQueries[0][0]);
+	}
+
+	/// Create shaders for light shafts calculated from the occlusion packed into bits
+	bitmaskShader = bitmaskCompositeShader = 0;
+	if (mode == SHAFTS_MODE_BITMASK)
+	{
+		CreateComputeProgram(bitmaskShader, "data/shaders/light_shafts_bitmask_cs.glsl");
+		CreateQuadProgram(bitmaskCompositeShader, "data/shaders/light_shafts_bitmask_fs.glsl");
+	}
+
+	/// Create shaders for light shafts skipping the uniform occlusion
+	minMaxShader = skipShader = 0;
+	skipValidateQuery = 0;
+	if (mode == SHAFTS_MODE_SKIP)
+	{
+		CreateQuadProgram(minMaxShader, "data/shaders/light_shafts_minmax_fs.glsl");
+		CreateQuadProgram(skipShader, "data/shaders/light_shafts_skip_fs.glsl");
+		glGenQueries(1, &skipValidateQuery);
+	}
+
+	/// Create a shader for making the occlusion from the depth of the normal scene
+	depthOcclusionShader = 0;
+	if (depthOcclusion)
+	{
+		CreateQuadProgram(depthOcclusionShader, "data/shaders/light_shafts_depth_occlusion_fs.glsl");
+	}
+
+	/// Create a shader for copying the final scene to the screen
+	CreateQuadProgram(resolveShader, "data/shaders/light_shafts_resolve_fs.glsl");
+
+	/// Create a shader for light shafts with the adaptive number of taps
+	adaptiveShader = 0;
+	if (mode == SHAFTS_MODE_ADAPTIVE)
+	{
+		CreateQuadProgram(adaptiveShader, "data/shaders/light_shafts_adaptive_fs.glsl");
+	}
+
+	/// Create shaders for light shafts calculated only on classified tiles with the buffer of their indirect
+	/// draw commands (the brightest occlusion of every tile and lists of tiles are made with render targets).
+	tileReduceShader = tileClassifyShader = tileShader = tileCopyShader = 0;
+	tileCommandsBuffer = 0;
+	if (tileClassification)
+	{
+		CreateComputeProgram(tileReduceShader, "data/shaders/light_shafts_tile_reduce_cs.glsl");
+		CreateComputeProgram(tileClassifyShader, "data/shaders/light_shafts_tile_classify_cs.glsl");
+		CreateQuadProgram(tileShader, "data/shaders/light_shafts_fs.glsl", "data/shaders/light_shafts_tile_vs.glsl");
+		CreateQuadProgram(tileCopyShader, "data/shaders/light_shafts_tile_copy_fs.glsl", "data/shaders/light_shafts_tile_vs.glsl");
+		glGenBuffers(1, &tileCommandsBuffer);
+		GLState::BindBuffer(GL_DRAW_INDIRECT_BUFFER, tileCommandsBuffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(GLuint) * 8, NULL, GL_DYNAMIC_DRAW);
+		GLState::BindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+
+	/// Create a shader for light shafts of many lights and the uniform buffer with their positions and colors
+	CreateQuadProgram(multiLightShader, "data/shaders/light_shafts_multi_fs.glsl");
+	glGenBuffers(1, &lightsUBO);
+	GLState::BindBuffer(GL_UNIFORM_BUFFER, lightsUBO);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(ShaftsLightsData), NULL, GL_DYNAMIC_DRAW);
+	GLState::BindBuffer(GL_UNIFORM_BUFFER, 0);
+	lightsCount = 0;
+	lightsSamples = 0;
+
+	/// The sweep calculates only first 1, 4, 16 and 64 lights (up to the number of lights) for ProfileInterval
+	/// frames each, so every printed line of the profiler has the time of the light shafts pass of one of them.
+	lightsSweep = ENGINE->config->GetBoolean("Benchmark", "LightsSweep", false) && ENGINE->profiler->enabled && ENGINE->scene->lights.size() > 1;
+	sweepInterval = glm::max(1, (int)ENGINE->config->GetInteger("Benchmark", "ProfileInterval", 120));
+	sweepFrame = 0;
+	lightsLimit = lightsSweep ? 1 : SHAFTS_MAX_LIGHTS;
+	if (lightsSweep)
+	{
+		printf("Lights sweep: up to %d lights\n", lightsLimit);
+	}
+
+	/// Create a compute shader for light shafts calculated tile by tile
+	computeShader = 0;
+	if (mode == SHAFTS_MODE_COMPUTE)
+	{
+		CreateComputeProgram(computeShader, "data/shaders/light_shafts_compute_cs.glsl");
+	}
 
 	// Fill the uniform buffer with first values.
 	UpdateUniformBuffer();
 }
 
+/**
+* Create render targets of the size of the screen (of the render size of the camera). Their textures
+* are taken from the render target pool, so the ones made again with a size that was used recently
+* (the window resized back, the render scale going up and down) are not created by the driver again.
+*/
+void LightShafts::CreateTargets()
+{
+	// Remember the camera from scene so we can use it in the future
+	Camera * localCamera = ENGINE->scene->camera;
+
+	/// The occlusion only tells how much light passes (occluders are black), the color of the light is given
+	/// to shaders with it. So it has a single channel and can be smaller than the screen, which makes
+	/// the radial blur read 4 times (and with the downsample 16 or 64 times) less memory.
+	/// In cone mode the occlusion is read from mipmaps, so all mip levels are needed (down to 1x1).
+	occlusionWidth	= glm::max(1, localCamera->renderWidth / occlusionDownsample);
+	occlusionHeight	= glm::max(1, localCamera->renderHeight / occlusionDownsample);
+	GLenum occlusionFormat = occlusionTargetFormat->internalFormat;
+	occlusionMipLevels = (mode == SHAFTS_MODE_CONE) ? CountMipLevels(occlusionWidth, occlusionHeight) : 1;
+	CreateTexture(occlusionTexture, occlusionFormat, occlusionWidth, occlusionHeight, GL_LINEAR, occlusionMipLevels);
+
+	/// In bitmask mode every texel of the occlusion becomes one bit, 32 of them are packed side by side
+	/// into one unsigned integer. There are two of them: the light passing and the light marker.
+	/// It is the only integer texture, so it is not taken from the pool.
+	bitmaskTexture = 0;
+	bitmaskWidth = (occlusionWidth + 31) / 32;
+	if (mode == SHAFTS_MODE_BITMASK)
+	{
+		glGenTextures(1, &bitmaskTexture);
+		GLState::BindTexture(GL_TEXTURE_2D, bitmaskTexture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32UI, bitmaskWidth, occlusionHeight, 0, GL_RG_INTEGER, GL_UNSIGNED_INT, NULL);
+		GLState::BindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	// In skip mode the min/max pyramid has all levels down to 1x1. It keeps the format of the occlusion,
+	// so the uniform occlusion is exactly the same as the one read by taps.
+	minMaxTexture = minMaxFrameBuffer = 0;
+	minMaxLevels = 0;
+	if (mode == SHAFTS_MODE_SKIP)
+	{
+		GLenum minMaxFormat = GL_RG16F;
+		if (occlusionFormat == GL_R8)	minMaxFormat = GL_RG8;
+		if (occlusionFormat == GL_R16)	minMaxFormat = GL_RG16;
+		if (occlusionFormat == GL_R32F)	minMaxFormat = GL_RG32F;
+		minMaxLevels = CountMipLevels(occlusionWidth, occlusionHeight);
+		CreateRenderTarget(minMaxTexture, minMaxFrameBuffer, minMaxFormat, occlusionWidth, occlusionHeight, GL_NEAREST, minMaxLevels);
+	}
+
+	// Make textures for light scattering calculated in lower resolution than the screen.
+	// They store the depth in alpha too, so they can be upsampled without leaking through silhouettes.
+	// There are two of them, so passes can read the result of the previous one (ping-pong).
+	scatterWidth	= glm::max(1, localCamera->renderWidth / downsample);
+	scatterHeight	= glm::max(1, localCamera->renderHeight / downsample);
+	// In temporal mode they are the history averaged over many frames, which needs full floats.
+	GLenum scatterFormat = (mode == SHAFTS_MODE_TEMPORAL) ? GL_RGBA32F : GL_RGBA16F;
+	scatterResult	= 0;
+	CreateRenderTarget(scatterTextures[0], scatterFrameBuffers[0], scatterFormat, scatterWidth, scatterHeight, GL_LINEAR);
+	CreateRenderTarget(scatterTextures[1], scatterFrameBuffers[1], scatterFormat, scatterWidth, scatterHeight, GL_LINEAR);
+
+	// In temporal mode every scatter texture has the texture with the age of its history next to it.
+	// They are rendered together, so each pair has its own frame buffer with two color attachments.
+	temporalAgeTextures[0] = temporalAgeTextures[1] = 0;
+	temporalFrameBuffers[0] = temporalFrameBuffers[1] = 0;
+	temporalFrame = 0;
+	if (mode == SHAFTS_MODE_TEMPORAL)
+	{
+		GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+		for (int i = 0; i < 2; i++)
+		{
+			CreateTexture(temporalAgeTextures[i], GL_R16F, scatterWidth, scatterHeight, GL_NEAREST);
+			glGenFramebuffers(1, &temporalFrameBuffers[i]);
+			GLState::BindFramebuffer(GL_DRAW_FRAMEBUFFER, temporalFrameBuffers[i]);
+			glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, scatterTextures[i], 0);
+			glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, temporalAgeTextures[i], 0);
+			glDrawBuffers(2, drawBuffers);
+		}
+	}
+
+	/// The final scene is rendered in half floats and copied to the screen when it needs dithering, or when
+	/// the normal scene has more precision than the screen (so light shafts are not rounded before it).
+	/// With the lower render scale it is also upscaled to the screen while copying (filtered linearly).
+	resolveTexture = resolveFrameBuffer = 0;
+	bool scaled = localCamera->renderWidth != localCamera->outputWidth || localCamera->renderHeight != localCamera->outputHeight;
+	useResolve = dither || colorTargetFormat->internalFormat != GL_RGBA8 || scaled;
+	if (useResolve)
+	{
+		CreateRenderTarget(resolveTexture, resolveFrameBuffer, GL_RGBA16F, localCamera->renderWidth, localCamera->renderHeight, scaled ? GL_LINEAR : GL_NEAREST);
+	}
+
+	// Classified tiles need the brightest occlusion of every tile and both lists of tiles (as long as all tiles).
+	tileTexture = tileListsBuffer = 0;
+	tilesX = (localCamera->renderWidth + 15) / 16;
+	tilesY = (localCamera->renderHeight + 15) / 16;
+	tileScale = glm::vec2(16.0f / localCamera->renderWidth, 16.0f / localCamera->renderHeight);
+	if (tileClassification)
+	{
+		CreateTexture(tileTexture, GL_R16F, tilesX, tilesY, GL_NEAREST);
+		glGenBuffers(1, &tileListsBuffer);
+		GLState::BindBuffer(GL_SHADER_STORAGE_BUFFER, tileListsBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * 2 * tilesX * tilesY, NULL, GL_DYNAMIC_DRAW);
+		GLState::BindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+
+	// Bind the basic frame buffer for now in order to not make a mess.
+	GLState::BindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+}
+
+/**
+* Give render targets of the size of the screen back to the render target pool (and delete the rest of them).
+*/
+void LightShafts::DeleteTargets()
+{
+	RenderTargetPool * pool = ENGINE->scene->targetPool;
+	pool->Release(occlusionTexture);
+	pool->Release(minMaxTexture);
+	pool->Release(scatterTextures[0]);
+	pool->Release(scatterTextures[1]);
+	pool->Release(temporalAgeTextures[0]);
+	pool->Release(temporalAgeTextures[1]);
+	pool->Release(resolveTexture);
+	pool->Release(tileTexture);
+	GLState::DeleteTextures(1, &bitmaskTexture);
+	GLState::DeleteFramebuffers(1, &minMaxFrameBuffer);
+	GLState::DeleteFramebuffers(2, scatterFrameBuffers);
+	GLState::DeleteFramebuffers(2, temporalFrameBuffers);
+	GLState::DeleteFramebuffers(1, &resolveFrameBuffer);
+	GLState::DeleteBuffers(1, &tileListsBuffer);
+}
+
+/**
+* Make render targets of the size of the screen again for the current render size of the camera
+* (after the window or the render scale changed). The old ones go back to the render target pool first,
+* so the new ones can be taken from it. Accumulated history is lost, so it starts again.
+*/
+void LightShafts::Resize()
+{
+	DeleteTargets();
+	CreateTargets();
+}
+
+/**
+* Create the program that draws the quad filling whole screen with the given fragment shader.
+* The program shares the vertex attributes locations and the uniform buffer binding with
+* the main light shafts shader so the same buffers can be used.
+* @param program		- Handler of the program to create
+* @param path			- Path to the fragment shader file
+* @param vertexPath		- Path to the vertex shader file
+* @param defines		- Lines of #define directives specializing the fragment shader
+*/
+void LightShafts::CreateQuadProgram(GLuint &program, const char *path, const char *vertexPath, const std::string &defines)
+{
+	// Make sure the handler doesn't point to any existing program, so the new one will be created.
+	program = 0;
+	Shaders::AttachShader(program, GL_VERTEX_SHADER, vertexPath);
+	Shaders::AttachShader(program, GL_FRAGMENT_SHADER, path, defines);
+
+	// Use the same locations as in the main shader, so the quad vertex array object can be shared.
+	glBindAttribLocation(program, vertex_loc, "inPosition");
+	glBindAttribLocation(program, texcoord_loc, "inTexCoord");
+	Shaders::LinkProgram(program);
+
+	// When the program uses light shafts parameters bind them to the same uniform buffer.
+	GLuint shaftsParamsIndex = glGetUniformBlockIndex(program, "ShaftsParams");
+	if (shaftsParamsIndex != GL_INVALID_INDEX)
+	{
+		glUniformBlockBinding(program, shaftsParamsIndex, 0);
+	}
+
+	// When the program uses many lights bind them to the second uniform buffer.
+	GLuint shaftsLightsIndex = glGetUniformBlockIndex(program, "ShaftsLights");
+	if (shaftsLightsIndex != GL_INVALID_INDEX)
+	{
+		glUniformBlockBinding(program, shaftsLightsIndex, 1);
+	}
+}
+
+/**
+* Get the quad program with the given fragment shader specialized with the given defines.
+* It is created only once for every set of defines and taken from the cache after that.
+* @param path		- Path to the fragment shader file
+* @param defines	- Lines of #define directives specializing the fragment shader
+* @returns handler of the program
+*/
+GLuint LightShafts::GetProgramVariant(const char *path, const std::string &defines)
+{
+	std::string key = std::string(path) + "\n" + defines;
+	std::map<std::string, GLuint>::iterator variant = programVariants.find(key);
+	if (variant != programVariants.end())
+	{
+		return variant->second;
+	}
+
+	GLuint program = 0;
+	CreateQuadProgram(program, path, "data/shaders/light_shafts_vs.glsl", defines);
+	programVariants[key] = program;
+	return program;
+}
+
+/**
+* Switch the quality tier of the radial blur. Programs specialized for the tier are
+* compiled only the first time it is used, after that they are taken from the cache.
+* @param newQuality - quality tier to use from now on
+*/
+void LightShafts::SetQuality(ShaftsQuality newQuality)
+{
+	quality = newQuality;
+
+	/// Numbers of taps are known from the configuration, so loops of the radial blur
+	/// can be compiled with constant bounds.
+	char defines[128];
+	sprintf(defines, "#define SAMPLES %d\n", samples);
+	radialShader = GetProgramVariant("data/shaders/light_shafts_fs.glsl", defines);
+	if (quality == SHAFTS_QUALITY_LOW)
+	{
+		sprintf(defines, "#define SAMPLES %d\n#define NOISE_SAMPLES %d\n", samples, noiseSamples);
+		radialScatterShader = GetProgramVariant("data/shaders/light_shafts_noise_fs.glsl", defines);
+	}
+	else
+	{
+		radialScatterShader = GetProgramVariant("data/shaders/light_shafts_scatter_fs.glsl", defines);
+	}
+}
+
+/**
+* Create the program with the given compute shader. If the program uses light shafts
+* parameters they are bound to the same uniform buffer as in the main light shafts shader.
+* @param program	- Handler of the program to create
+* @param path		- Path to the compute shader file
+*/
+void LightShafts::CreateComputeProgram(GLuint &program, const char *path)
+{
+	program = 0;
+	Shaders::AttachShader(program, GL_COMPUTE_SHADER, path);
+	Shaders::LinkProgram(program);
+
+	GLuint shaftsParamsIndex = glGetUniformBlockIndex(program, "ShaftsParams");
+	if (shaftsParamsIndex != GL_INVALID_INDEX)
+	{
+		glUniformBlockBinding(program, shaftsParamsIndex, 0);
+	}
+}
+
+/**
+* Create the texture with the frame buffer rendering to it.
+* @param texture		- Handler of the texture to create
+* @param frameBuffer	- Handler of the frame buffer to create
+* @param internalFormat	- Format of the texture
+* @param width			- Width of the texture
+* @param height			- Height of the texture
+* @param filter			- Filter used when the texture is sampled
+* @param levels			- Number of mip levels of the texture
+*/
+void LightShafts::CreateRenderTarget(GLuint &texture, GLuint &frameBuffer, GLenum internalFormat, int width, int height, GLenum filter, int levels)
+{
+	CreateTexture(texture, internalFormat, width, height, filter, levels);
+
+	glGenFramebuffers(1, &frameBuffer);
+	GLState::BindFramebuffer(GL_DRAW_FRAMEBUFFER, frameBuffer);
+	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+	GLState::BindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+}
+
+/**
+* Take the texture without any frame buffer (for example to write it from compute shader) from the render target pool.
+* @param texture		- Handler of the texture to create
+* @param internalFormat	- Format of the texture
+* @param width			- Width of the texture
+* @param height			- Height of the texture
+* @param filter			- Filter used when the texture is sampled
+* @param levels			- Number of mip levels of the texture
+*/
+void LightShafts::CreateTexture(GLuint &texture, GLenum internalFormat, int width, int height, GLenum filter, int levels)
+{
+	FrameGraphTextureDesc desc;
+	desc.internalFormat = internalFormat;
+	desc.width = width;
+	desc.height = height;
+	desc.layers = 0;
+	desc.levels = levels;
+	desc.filter = filter;
+	desc.bytes = RenderTargetPool::GetTexelBytes(internalFormat);
+	desc.clear = false;
+	texture = ENGINE->scene->targetPool->Acquire(desc);
+}
+
+/**
+* Count mip levels of the texture down to 1x1.
+* @param width	- Width of the texture
+* @param height	- Height of the texture
+* @return Number of mip levels
+*/
+int LightShafts::CountMipLevels(int width, int height)
+{
+	int levels = 1;
+	while (width > 1 || height > 1)
+	{
+		width = glm::max(1, width / 2);
+		height = glm::max(1, height / 2);
+		levels++;
+	}
+	return levels;
+}
+
 /**
 * Update the uniform buffer with new light shafts parameters.
 */
 void LightShafts::UpdateUniformBuffer()
 {
-	glBindBufferBase(GL_UNIFORM_BUFFER, 0, UBO);
+	GLState::BindBufferBase(GL_UNIFORM_BUFFER, 0, UBO);
 		glBufferSubData(GL_UNIFORM_BUFFER, uniformsOffset[0], 4, &samples);
 		glBufferSubData(GL_UNIFORM_BUFFER, uniformsOffset[1], 4, &exposure);
 		glBufferSubData(GL_UNIFORM_BUFFER, uniformsOffset[2], 4, &decay);
 		glBufferSubData(GL_UNIFORM_BUFFER, uniformsOffset[3], 4, &density);
 		glBufferSubData(GL_UNIFORM_BUFFER, uniformsOffset[4], 4, &weight);
-	glBindBufferBase(GL_UNIFORM_BUFFER, 0, 0);
 }
 
-/*
-* Run this before rendering the occlusion. The occlusion will be saved
-* to texture and used to compose the light shafts effect.
+/**
+* Declare render targets of the normal scene and the occlusion in the frame graph.
+* The color and the depth of the normal scene and the depth of the occlusion are created
+* by the graph, the occlusion (with its mip levels and other textures made from it) stays here.
+* @param graph - the frame graph of the scene
 * @param scene - the current scene
 */
-void LightShafts::StartDrawingOcclusion(Scene * scene)
+void LightShafts::DeclareTargets(FrameGraph * graph, Scene * scene)
 {
-	// Bind and clear the buffer for rendering occlusion
-	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, frameBuffers[0]);
-	glViewport(0, 0, scene->camera->renderWidth, scene->camera->renderHeight);
-	glClearColor(	backLightColor*scene->light->diffuse[0], 
-					backLightColor*scene->light->diffuse[1], 
-					backLightColor*scene->light->diffuse[2], 
-					backLightColor*scene->light->diffuse[3]);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	Camera * camera = scene->camera;
+	FrameGraphTextureDesc desc;
+
+	// The normal scene is cleared with the background color.
+	desc.internalFormat = colorTargetFormat->internalFormat;
+	desc.width = camera->renderWidth;
+	desc.height = camera->renderHeight;
+	desc.layers = 1;
+	desc.levels = 1;
+	desc.filter = GL_LINEAR;
+	desc.bytes = colorTargetFormat->bytes;
+	desc.clear = true;
+	for (int i = 0; i < 4; i++)
+	{
+		desc.clearValue[i] = scene->bgColor[i];
+	}
+	sceneColorTarget = graph->CreateTexture("Scene color", desc);
+
+	desc.internalFormat = depthTargetFormat->internalFormat;
+	desc.bytes = depthTargetFormat->bytes;
+	desc.clearValue[0] = 1;
+	sceneDepthTarget = graph->CreateTexture("Scene depth", desc);
+
+	/// The occlusion depth is a one layer array like the scene depth, so with the occlusion of the screen size
+	/// both can be the same texture when the occlusion is drawn before the normal scene.
+	desc.width = occlusionWidth;
+	desc.height = occlusionHeight;
+	occlusionDepthTarget = graph->CreateTexture("Occlusion depth", desc);
+
+	/// The occlusion stays white, it is tinted with the color of the light when light shafts are drawn
+	/// (with many lights every light tints it with its own color).
+	/// The back light is blurred by every light, so it is split between them to not get brighter.
+	desc.internalFormat = occlusionTargetFormat->internalFormat;
+	desc.layers = 0;
+	desc.bytes = occlusionTargetFormat->bytes;
+	desc.clearValue[0] = backLightColor / scene->lights.size();
+	occlusionTarget = graph->ImportTexture("Occlusion", occlusionTexture, desc);
+
+	// Light shafts draw to the screen by themselves.
+	desc.internalFormat = GL_RGBA8;
+	desc.width = camera->renderWidth;
+	desc.height = camera->renderHeight;
+	desc.bytes = 4;
+	desc.clear = false;
+	screenTarget = graph->ImportTexture("Screen", 0, desc);
+}
+
+/**
+* Take textures created by the compiled frame graph.
+* @param graph - the compiled frame graph of the scene
+*/
+void LightShafts::AcquireTargets(FrameGraph * graph)
+{
+	renderTextureArrayColor = graph->GetTexture(sceneColorTarget);
+	renderTextureArrayDepth = graph->GetTexture(sceneDepthTarget);
+
+	// The normal scene is copied to the screen from its own frame buffer when there are no light shafts.
+	// The graph is made again when the size changes, so the frame buffer of its previous textures goes away.
+	GLState::DeleteFramebuffers(1, &normalFrameBuffer);
+	glGenFramebuffers(1, &normalFrameBuffer);
+	GLState::BindFramebuffer(GL_READ_FRAMEBUFFER, normalFrameBuffer);
+	glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, renderTextureArrayColor, 0, 0);
+	GLState::BindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+	/// Remember how much memory render targets of the occlusion, the resolve and transients of the graph
+	/// (the normal scene and depths) take, so formats can be compared together with the time of passes.
+	GLfloat occlusionMegabytes = (GLfloat)occlusionWidth * occlusionHeight * occlusionTargetFormat->bytes / (1024 * 1024);
+	GLfloat resolveMegabytes = useResolve ? (GLfloat)ENGINE->scene->camera->renderWidth * ENGINE->scene->camera->renderHeight * 8 / (1024 * 1024) : 0;
+	GLfloat transientMegabytes = graph->GetTransientMegabytes();
+	targetsMegabytes = occlusionMegabytes + resolveMegabytes + transientMegabytes;
+	if (ENGINE->profiler->enabled)
+	{
+		printf("Render targets: color %s, depth %s, occlusion %s %.1f MB, resolve %.1f MB, transient %.1f MB\n",
+			colorTargetFormat->name, depthTargetFormat->name, occlusionTargetFormat->name, occlusionMegabytes,
+			resolveMegabytes, transientMegabytes);
+	}
 }
 
 /*
-* Run this before rendering the normal scene. This scene will be saved
-* to texture and used to compose the light shafts effect.
+* Run this after rendering the occlusion scene. It draws light markers into the occlusion.
+* With a single light it counts how much of its marker is visible, so light shafts can be
+* skipped when it is fully hidden.
+* @param lights	- all point lights making light shafts
+*/
+void LightShafts::DrawLightMarkers(const std::vector<Light*> &lights)
+{
+	/// In the single pass markers go only to the occlusion attachment (which becomes the first draw buffer,
+	/// so the marker shader writes to it) and don't change the depth of the normal scene.
+	if (singlePass)
+	{
+		GLenum occlusionBuffer = GL_COLOR_ATTACHMENT1;
+		glDrawBuffers(1, &occlusionBuffer);
+		glDepthMask(GL_FALSE);
+	}
+
+	DrawMarkers(lights);
+
+	if (singlePass)
+	{
+		GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+		glDrawBuffers(2, drawBuffers);
+		glDepthMask(GL_TRUE);
+	}
+}
+
+/**
+* Draw light markers into the currently bound occlusion, counting how much of the single marker is visible.
+* @param lights	- all point lights making light shafts
+*/
+void LightShafts::DrawMarkers(const std::vector<Light*> &lights)
+{
+	/// Many lights share the occlusion of the scene, but a marker is the source of its own light only, otherwise
+	/// every light would make light shafts from markers of all other lights too. So markers are not drawn into it,
+	/// every light adds its own disc while it calculates its light scattering (see UpdateLightsBuffer).
+	if (lights.size() > 1)
+	{
+		return;
+	}
+
+	// The single light marker is white too, the occlusion is tinted with its color later.
+	Light * light = lights[0];
+	GLfloat white[4] = { 1, 1, 1, 1 };
+	if (occlusionQuery == false)
+	{
+		light->DrawTheMarker(white);
+		return;
+	}
+
+	/// Read how much of the marker was visible in the previous frame. Its queries should be ready
+	/// by now, but don't wait for them if they are not (then the older visibility stays).
+	int previousFrame = 1 - markerQueryFrame;
+	GLuint available = 0;
+	if (markerQueryIssued[previousFrame] == true)
+	{
+		glGetQueryObjectuiv(markerQueries[previousFrame][0], GL_QUERY_RESULT_AVAILABLE, &available);
+	}
+	if (available != 0)
+	{
+		GLuint visibleSamples, allSamples;
+		glGetQueryObjectuiv(markerQueries[previousFrame][0], GL_QUERY_RESULT, &visibleSamples);
+		glGetQueryObjectuiv(markerQueries[previousFrame][1], GL_QUERY_RESULT, &allSamples);
+		markerVisibility = (allSamples > 0) ? glm::min(1.0f, (GLfloat)visibleSamples / allSamples) : 1.0f;
+		markerQueryIssued[previousFrame] = false;
+	}
+
+	// Count all samples of the marker first, without the depth test and without changing the occlusion.
+	GLboolean depthMask;
+	glGetBooleanv(GL_DEPTH_WRITEMASK, &depthMask);
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	glDepthMask(GL_FALSE);
+	glDisable(GL_DEPTH_TEST);
+	glBeginQuery(GL_SAMPLES_PASSED, markerQueries[markerQueryFrame][1]);
+		light->DrawTheMarker(white);
+	glEndQuery(GL_SAMPLES_PASSED);
+	glEnable(GL_DEPTH_TEST);
+	glDepthMask(depthMask);
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+	// Then draw it for real and count samples that are not hidden behind the occlusion scene.
+	glBeginQuery(GL_SAMPLES_PASSED, markerQueries[markerQueryFrame][0]);
+		light->DrawTheMarker(white);
+	glEndQuery(GL_SAMPLES_PASSED);
+
+	markerQueryIssued[markerQueryFrame] = true;
+	markerQueryFrame = previousFrame;
+}
+
+/*
+* Run this after rendering the normal scene instead of rendering the occlusion scene. It makes the occlusion
+* from the depth of the normal scene: the sky lets the light pass, the geometry doesn't, and discs
+* of light markers are added in front of the geometry.
 * @param scene - the current scene
 */
-void LightShafts::StartDrawingNormal(Scene * scene)
+void LightShafts::DrawDepthOcclusion(Scene * scene)
 {
-	// Bind and clear the buffer for rendering normal scene
-	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, frameBuffers[1]);
-	glViewport(0, 0, scene->camera->renderWidth, scene->camera->renderHeight);
-	glClearColor(scene->bgColor[0], scene->bgColor[1], scene->bgColor[2], scene->bgColor[3]);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	/// Only the single light has its marker in the occlusion, many lights add their own discs later
+	/// (like when the occlusion is drawn). Lights behind the camera have no markers.
+	glm::vec4 markers[SHAFTS_MAX_LIGHTS];
+	GLfloat markerDepths[SHAFTS_MAX_LIGHTS];
+	int markerCount = 0;
+	if (scene->lights.size() == 1 && GetMarkerDisc(scene->camera, scene->lights[0], markers[0], markerDepths[0]))
+	{
+		markerCount = 1;
+	}
+
+	// The sky is the same as when the occlusion is drawn, split between lights.
+	GLfloat lightShare = 1.0f / scene->lights.size();
+	GLfloat markerLight = 1.0f;
+
+	// Every texel of the occlusion is written (the graph doesn't clear it), so there is nothing to test.
+	glDisable(GL_DEPTH_TEST);
+	GLState::UseProgram(depthOcclusionShader);
+
+		BindTextures(depthOcclusionShader);
+		glUniform1f(glGetUniformLocation(depthOcclusionShader, "skyLight"), backLightColor * lightShare);
+		glUniform1f(glGetUniformLocation(depthOcclusionShader, "markerLight"), markerLight);
+		glUniform1i(glGetUniformLocation(depthOcclusionShader, "markerCount"), markerCount);
+		glUniform4fv(glGetUniformLocation(depthOcclusionShader, "markers"), markerCount, glm::value_ptr(markers[0]));
+		glUniform1fv(glGetUniformLocation(depthOcclusionShader, "markerDepths"), markerCount, markerDepths);
+
+		DrawQuad();
+
+	glEnable(GL_DEPTH_TEST);
 }
 
 /*
 * After getting occlusion texture and normal scene texture run this method.
 * It will compose previous textures and render the final scene on the screen.
 * @param camera - currently using camera
-* @param light	- currently using point light
+* @param lights	- all point lights making light shafts
 */
-void LightShafts::DrawLightShafts(Camera * camera, Light * light)
+void LightShafts::DrawLightShafts(Camera * camera, const std::vector<Light*> &lights)
 {
-	// Bind and clear the buffer (default one) for rendering the final scene
-	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-	glViewport(0, 0, camera->renderWidth, camera->renderHeight);
-	glClearColor(0, 0, 0, 1);
+	/// Get the screen position of point light in (0,1) coordinates and the intensity of its light shafts.
+	/// The position is needed for future light shafts calculations in shader (because the whole effect is a post process).
+	/// Many lights are culled and put into the uniform buffer instead, so they can be calculated in one pass.
+	glm::vec2 lightScreenPosition = glm::vec2(0);
+	bool lightOnScreen = false;
+	GLfloat intensity;
+	if (lights.size() > 1)
+	{
+		intensity = UpdateLightsBuffer(camera, lights);
+		lightColor = glm::vec3(1);
+	}
+	else
+	{
+		intensity = GetScreenIntensity(camera, lights[0], lightScreenPosition, lightOnScreen);
+		lightColor = glm::vec3(lights[0]->diffuse[0], lights[0]->diffuse[1], lights[0]->diffuse[2]);
+	}
+
+	/// The light marker is counted only when it is on the screen. Its visibility is known one frame
+	/// late, so it can only scale light shafts smoothly, the current frame is handled by the GPU below.
+	bool useMarkerQuery = occlusionQuery && lightOnScreen;
+	if (useMarkerQuery && occlusionFade)
+	{
+		intensity *= markerVisibility;
+	}
+
+	ENGINE->profiler->AddCounter("Targets MB", targetsMegabytes);
+
+	// Without light shafts just copy the normal scene to the screen, there is no need to calculate anything.
+	if (intensity <= 0)
+	{
+		CopyNormalScene(camera);
+		return;
+	}
+
+	/// When no sample of the light marker passed the depth test the light is fully hidden. The GPU checks it
+	/// itself and skips all light shafts draws, showing the normal scene instead (the CPU never waits for it).
+	/// Without inverted conditional rendering the normal scene is copied every time and covered when needed.
+	GLuint markerQuery = markerQueries[1 - markerQueryFrame][0];
+
+	/// The temporal history is followed on the CPU (its frame, matrix and light position), so its pass runs
+	/// before the conditional rendering. A frame skipped by the GPU would leave the history unwritten while
+	/// the CPU moved on, and the light coming out from behind the model would blend it.
+	if (lights.size() == 1 && mode == SHAFTS_MODE_TEMPORAL)
+	{
+		DrawTemporalScattering(camera, lightScreenPosition);
+	}
+
+	if (useMarkerQuery)
+	{
+		if (GLEW_VERSION_4_5 || GLEW_ARB_conditional_render_inverted)
+		{
+			glBeginConditionalRender(markerQuery, GL_QUERY_WAIT_INVERTED);
+				CopyNormalScene(camera);
+			glEndConditionalRender();
+		}
+		else
+		{
+			CopyNormalScene(camera);
+		}
+		glBeginConditionalRender(markerQuery, GL_QUERY_WAIT);
+	}
+
+	/// Some methods calculate light shafts into a separate texture first.
+	/// The final scene will be composed from this texture.
+	GLuint finalShader = radialShader;
+	if (lights.size() > 1)
+	{
+		DrawMultiLightScattering(camera);
+		finalShader = upsampleShader;
+	}
+	else if (mode == SHAFTS_MODE_EPIPOLAR)
+	{
+		DrawEpipolarLines(camera, lightScreenPosition);
+		finalShader = epipolarCompositeShader;
+	}
+	else if (mode == SHAFTS_MODE_HIERARCHICAL)
+	{
+		DrawHierarchicalScattering(camera, lightScreenPosition);
+		finalShader = upsampleShader;
+	}
+	else if (mode == SHAFTS_MODE_POLAR)
+	{
+		DrawPolarScattering(camera, lightScreenPosition);
+		finalShader = upsampleShader;
+	}
+	else if (mode == SHAFTS_MODE_COMPUTE)
+	{
+		DrawComputeScattering(camera, lightScreenPosition);
+		finalShader = upsampleShader;
+	}
+	else if (mode == SHAFTS_MODE_TEMPORAL)
+	{
+		finalShader = upsampleShader;
+	}
+	else if (mode == SHAFTS_MODE_CONE)
+	{
+		// Make mipmaps of the occlusion.
+		GLState::BindTexture(GL_TEXTURE_2D, occlusionTexture);
+		glGenerateMipmap(GL_TEXTURE_2D);
+		GLState::BindTexture(GL_TEXTURE_2D, 0);
+		finalShader = coneShader;
+	}
+	else if (mode == SHAFTS_MODE_BITMASK)
+	{
+		DrawOcclusionBitmask();
+		finalShader = bitmaskCompositeShader;
+	}
+	else if (mode == SHAFTS_MODE_SKIP)
+	{
+		DrawMinMaxPyramid();
+		finalShader = skipShader;
+	}
+	else if (mode == SHAFTS_MODE_ADAPTIVE)
+	{
+		finalShader = adaptiveShader;
+	}
+	else if (downsample > 1 || quality == SHAFTS_QUALITY_LOW)
+	{
+		DrawScattering(camera, lightScreenPosition);
+		finalShader = upsampleShader;
+	}
+	else if (tileClassification)
+	{
+		ClassifyTiles(camera, lightScreenPosition);
+		finalShader = tileShader;
+	}
+
+	// Bind and clear the buffer (default one or the resolve one) for rendering the final scene
+	GLState::BindFramebuffer(GL_DRAW_FRAMEBUFFER, useResolve ? resolveFrameBuffer : 0);
+	GLState::Viewport(0, 0, camera->renderWidth, camera->renderHeight);
+	GLState::ClearColor(0, 0, 0, 1);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	/// Get the screen position of point light in (0,1) coordinates. It is needed for future
-	/// light shafts calculations in shader (because the whole effect is a post process).
+	/// Draw the final scene using the texture array containing the occlusion and normal scene.
+	/// Also the screen position of point light is needed. Use vertex buffers with positions and
+	/// texture coordinates of quad that fills whole screen.
+	GLState::UseProgram(finalShader);
+
+		BindTextures(finalShader);
+		glUniform2fv(glGetUniformLocation(finalShader, "lightScreenPos"), 1, glm::value_ptr(lightScreenPosition));
+		glUniform2f(glGetUniformLocation(finalShader, "clipPlanes"), camera->GetNear(), camera->GetFar());
+		glUniform1f(glGetUniformLocation(finalShader, "depthThreshold"), epipolarDepthThreshold);
+		glUniform1f(glGetUniformLocation(finalShader, "depthSigma"), downsampleDepthSigma);
+		glUniform1f(glGetUniformLocation(finalShader, "intensity"), intensity);
+		glUniform1i(glGetUniformLocation(finalShader, "coneSamples"), coneSamples);
+		glUniform1f(glGetUniformLocation(finalShader, "lodBias"), coneLodBias);
+		glUniform1f(glGetUniformLocation(finalShader, "backLight"), backLightColor);
+		glUniform2i(glGetUniformLocation(finalShader, "occlusionSize"), occlusionWidth, occlusionHeight);
+		glUniform1i(glGetUniformLocation(finalShader, "maxLevel"), minMaxLevels - 1);
+		glUniform1i(glGetUniformLocation(finalShader, "validate"), false);
+		glUniform1i(glGetUniformLocation(finalShader, "minSamples"), adaptiveMinSamples);
+		glUniform1f(glGetUniformLocation(finalShader, "epsilon"), adaptiveEpsilon);
+		glUniform1i(glGetUniformLocation(finalShader, "countTaps"), false);
+		if (mode == SHAFTS_MODE_EPIPOLAR)
+		{
+			SetEpipolarUniforms(finalShader, camera, lightScreenPosition);
+		}
+
+		if (finalShader == tileShader)
+		{
+			DrawTiles(finalShader, 0);
+		}
+		else
+		{
+			DrawQuad();
+		}
+
+	// Tiles without light shafts get only the normal scene.
+	if (finalShader == tileShader)
+	{
+		GLState::UseProgram(tileCopyShader);
+
+			BindTextures(tileCopyShader);
+			glUniform1f(glGetUniformLocation(tileCopyShader, "intensity"), intensity);
+			DrawTiles(tileCopyShader, 1);
+	}
+
+	if (useResolve)
+	{
+		DrawResolve();
+	}
+
+	if (useMarkerQuery)
+	{
+		glEndConditionalRender();
+	}
+
+	// Counting taps waits for the GPU, so do it only when they are printed.
+	bool validateSkipping = (mode == SHAFTS_MODE_SKIP && skipValidate);
+	bool countTaps = (mode == SHAFTS_MODE_ADAPTIVE && ENGINE->profiler->enabled);
+
+	/// Both checks read what light shafts have drawn, so they are done only when the GPU didn't skip them.
+	/// They wait for the GPU anyway, so the marker query can be read here too.
+	if (useMarkerQuery && (validateSkipping || countTaps))
+	{
+		GLuint visibleSamples = 0;
+		glGetQueryObjectuiv(markerQuery, GL_QUERY_RESULT, &visibleSamples);
+		if (visibleSamples == 0)
+		{
+			validateSkipping = countTaps = false;
+		}
+	}
+
+	if (validateSkipping)
+	{
+		ValidateSkipping();
+	}
+
+	if (countTaps)
+	{
+		CountAdaptiveTaps();
+	}
+
+	// Both draws are measured, so they can't be skipped by the conditional rendering.
+	if (mode == SHAFTS_MODE_CONE && ENGINE->profiler->enabled)
+	{
+		MeasureConeSaving(lightScreenPosition, intensity);
+	}
+}
+
+/**
+* Calculate the intensity of light shafts of the light from its position on the screen. They fade out
+* when the light leaves the screen and disappear when it is behind the camera.
+* @param camera					- currently using camera
+* @param light					- point light making light shafts
+* @param lightScreenPosition	- returns position of the light source on screen in (0,1) coordinates
+* @param lightOnScreen			- returns true when the light is inside of the screen
+* @returns intensity of light shafts (0 - none, 1 - full)
+*/
+GLfloat LightShafts::GetScreenIntensity(Camera * camera, Light * light, glm::vec2 &lightScreenPosition, bool &lightOnScreen)
+{
 	glm::vec4 lightNDCPosition = camera->GetViewProjectionMatrix() * glm::vec4(light->position, 1);
+	bool lightInFront = lightNDCPosition.w > 0;
 	lightNDCPosition /= lightNDCPosition.w;
-	glm::vec2 lightScreenPosition = glm::vec2(
+	lightScreenPosition = glm::vec2(
 		(lightNDCPosition.x + 1) * 0.5,
 		(lightNDCPosition.y + 1) * 0.5
 		);
+	lightOnScreen = lightInFront && lightScreenPosition == glm::clamp(lightScreenPosition, 0.0f, 1.0f);
 
-	/// Draw the final scene using the texture array containing the occlusion and normal scene.
-	/// Also the screen position of point light is needed. Use vertex buffers with positions and
-	/// texture coordinates of quad that fills whole screen.
-	glUseProgram(shader);
+	/// The light behind the camera can't make any light shafts (and its screen position means nothing).
+	/// When the light leaves the screen light shafts fade out smoothly to avoid popping,
+	/// and far enough outside of the screen they disappear.
+	GLfloat intensity = lightInFront ? 1.0f : 0.0f;
+	if (lightInFront && offscreenFadeDistance > 0)
+	{
+		glm::vec2 outside = glm::max(-lightScreenPosition, lightScreenPosition - glm::vec2(1));
+		GLfloat fade = glm::clamp(glm::max(glm::max(outside.x, outside.y), 0.0f) / offscreenFadeDistance, 0.0f, 1.0f);
+		intensity = 1.0f - fade * fade * (3.0f - 2.0f * fade);
+	}
+	return intensity;
+}
+
+/**
+* Find the disc of the light marker on the screen, the same way the marker shader draws it.
+* @param camera	- currently using camera
+* @param light	- point light with the marker
+* @param marker	- returns the disc of the marker (xy - center, zw - radius) in (0,1) coordinates
+* @param depth	- returns the depth of the marker (the same as in the depth texture)
+* @returns false when the light is behind the camera and has no marker
+*/
+bool LightShafts::GetMarkerDisc(Camera * camera, Light * light, glm::vec4 &marker, GLfloat &depth)
+{
+	// The scale is added to the projected position of the light, so on screen it is divided by the distance like the position.
+	glm::vec4 center = camera->GetViewProjectionMatrix() * glm::vec4(light->position, 1);
+	if (center.w <= 0)
+	{
+		return false;
+	}
+	glm::vec2 radius = light->GetMarkerScale() * 0.5f / center.w;
+	marker = glm::vec4(glm::vec2(center) / center.w * 0.5f + 0.5f, radius);
+	depth = center.z / center.w * 0.5f + 0.5f;
+	return true;
+}
+
+/**
+* Cull lights that don't make visible light shafts and fill the lights uniform buffer with the rest.
+* @param camera - currently using camera
+* @param lights	- all point lights making light shafts
+* @returns intensity of light shafts of the brightest light (0 when all lights are culled)
+*/
+GLfloat LightShafts::UpdateLightsBuffer(Camera * camera, const std::vector<Light*> &lights)
+{
+	/// The light contributes as much as its brightest color component after fading out.
+	/// Lights that contribute less than the threshold are not worth their taps.
+	ShaftsLightsData data;
+	GLfloat intensities[SHAFTS_MAX_LIGHTS];
+	GLfloat maxIntensity = 0;
+	lightsCount = 0;
+	UpdateLightsSweep((int)lights.size());
+	for (int i = 0; i < (int)lights.size() && lightsCount < lightsLimit; i++)
+	{
+		glm::vec2 lightScreenPosition;
+		bool lightOnScreen;
+		GLfloat intensity = GetScreenIntensity(camera, lights[i], lightScreenPosition, lightOnScreen);
+		glm::vec3 color = glm::vec3(lights[i]->diffuse[0], lights[i]->diffuse[1], lights[i]->diffuse[2]);
+		if (intensity * glm::max(color.r, glm::max(color.g, color.b)) <= lightCullThreshold)
+		{
+			continue;
+		}
+
+		// Lights in front of the camera always have markers (the others are faded out).
+		glm::vec4 marker;
+		GLfloat markerDepth;
+		if (GetMarkerDisc(camera, lights[i], marker, markerDepth) == false)
+		{
+			continue;
+		}
+
+		data.positions[lightsCount] = glm::vec4(lightScreenPosition, 0, 0);
+		data.colors[lightsCount] = glm::vec4(color, 1);
+		data.markers[lightsCount] = glm::vec4(marker.z, marker.w, markerDepth, 0);
+		intensities[lightsCount] = intensity;
+		maxIntensity = glm::max(maxIntensity, intensity);
+		lightsCount++;
+	}
+	ENGINE->profiler->AddCounter("Lights", lightsCount);
+	if (lightsCount == 0)
+	{
+		return 0;
+	}
+
+	// The final shader fades out to the normal scene by the brightest light, the rest are faded relatively to it.
+	for (int i = 0; i < lightsCount; i++)
+	{
+		data.colors[i] *= intensities[i] / maxIntensity;
+	}
+
+	/// Every light marches its own ray, so the pass does as many marches as there are lights. Only the number
+	/// of taps of every march goes down (to samples divided by the square root of the number of lights), which
+	/// trades the quality of every light for time, and it stops at minLightSamples, from where the time grows
+	/// linearly. Fewer samples are jittered and denoised like in low quality (which starts from less samples).
+	int baseSamples = (quality == SHAFTS_QUALITY_LOW) ? glm::min(noiseSamples, samples) : samples;
+	lightsSamples = (int)(baseSamples / sqrt((GLfloat)lightsCount));
+	lightsSamples = glm::clamp(lightsSamples, glm::min(minLightSamples, baseSamples), baseSamples);
+	data.count = lightsCount;
+	data.samples = lightsSamples;
+
+	// Only the part of arrays with culled lights is used, but std140 arrays have fixed offsets.
+	GLState::BindBuffer(GL_UNIFORM_BUFFER, lightsUBO);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::vec4) * lightsCount, data.positions);
+		glBufferSubData(GL_UNIFORM_BUFFER, offsetof(ShaftsLightsData, colors), sizeof(glm::vec4) * lightsCount, data.colors);
+		glBufferSubData(GL_UNIFORM_BUFFER, offsetof(ShaftsLightsData, markers), sizeof(glm::vec4) * lightsCount, data.markers);
+		glBufferSubData(GL_UNIFORM_BUFFER, offsetof(ShaftsLightsData, count), sizeof(GLint) * 2, &data.count);
+	GLState::BindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	return maxIntensity;
+}
+
+/**
+* Go to the next number of lights of the sweep when the current one was calculated long enough.
+* @param count - number of all lights
+*/
+void LightShafts::UpdateLightsSweep(int count)
+{
+	if (lightsSweep == false)
+	{
+		return;
+	}
+
+	sweepFrame++;
+	if (sweepFrame <= sweepInterval)
+	{
+		return;
+	}
+
+	// After the last number (all lights, but not more than fit into the buffer) the sweep starts again.
+	int maxLights = glm::min(count, SHAFTS_MAX_LIGHTS);
+	lightsLimit = (lightsLimit >= maxLights) ? 1 : glm::min(lightsLimit * 4, maxLights);
+	sweepFrame = 1;
+	printf("Lights sweep: up to %d lights\n", lightsLimit);
+}
+
+/**
+* Calculate the light scattering of all lights from the lights uniform buffer in one pass.
+* The result is left in the scatter texture of scatterResult index.
+* @param camera - currently using camera
+*/
+void LightShafts::DrawMultiLightScattering(Camera * camera)
+{
+	// Every light takes less samples than the radial blur, so they are jittered and denoised after that.
+	bool jitter = lightsSamples < samples;
+	scatterResult = 0;
+	GLState::BindFramebuffer(GL_DRAW_FRAMEBUFFER, scatterFrameBuffers[scatterResult]);
+	GLState::Viewport(0, 0, scatterWidth, scatterHeight);
+
+	GLState::UseProgram(multiLightShader);
+
+		BindTextures(multiLightShader);
+		glUniform2f(glGetUniformLocation(multiLightShader, "clipPlanes"), camera->GetNear(), camera->GetFar());
+		glUniform1i(glGetUniformLocation(multiLightShader, "jitter"), jitter);
+
+		GLState::BindBufferBase(GL_UNIFORM_BUFFER, 1, lightsUBO);
+			DrawQuad();
+
+	ENGINE->profiler->AddCounter("Light samples", lightsSamples);
+
+	if (jitter && denoiseRadius > 0)
+	{
+		DrawDenoise();
+	}
+}
+
+/**
+* Calculate light shafts along the epipolar lines and store them in the epipolar texture.
+* @param camera					- currently using camera
+* @param lightScreenPosition	- position of the light source on screen in (0,1) coordinates
+*/
+void LightShafts::DrawEpipolarLines(Camera * camera, const glm::vec2 &lightScreenPosition)
+{
+	// Bind the epipolar texture buffer. Every pixel of it is one sample on one line, so
+	// the light shafts are calculated only (lines * samples) times instead of for every pixel.
+	GLState::BindFramebuffer(GL_DRAW_FRAMEBUFFER, epipolarFrameBuffer);
+	GLState::Viewport(0, 0, epipolarSamples, epipolarLines);
+
+	GLState::UseProgram(epipolarShader);
+
+		BindTextures(epipolarShader);
+		glUniform2fv(glGetUniformLocation(epipolarShader, "lightScreenPos"), 1, glm::value_ptr(lightScreenPosition));
+		SetEpipolarUniforms(epipolarShader, camera, lightScreenPosition);
+
+		DrawQuad();
+}
+
+/**
+* Calculate the light scattering in lower resolution (or in low quality) and store it in the scatter texture.
+* @param camera					- currently using camera
+* @param lightScreenPosition	- position of the light source on screen in (0,1) coordinates
+*/
+void LightShafts::DrawScattering(Camera * camera, const glm::vec2 &lightScreenPosition)
+{
+	// Bind the scatter texture buffer. It is smaller than the screen, so the most expensive
+	// part of light shafts is calculated for much less pixels.
+	// In low quality only few jittered samples are calculated and the noise they leave is removed after that.
+	GLuint program = radialScatterShader;
+	scatterResult = 0;
+	GLState::BindFramebuffer(GL_DRAW_FRAMEBUFFER, scatterFrameBuffers[scatterResult]);
+	GLState::Viewport(0, 0, scatterWidth, scatterHeight);
+
+	GLState::UseProgram(program);
+
+		BindTextures(program);
+		glUniform2fv(glGetUniformLocation(program, "lightScreenPos"), 1, glm::value_ptr(lightScreenPosition));
+		glUniform2f(glGetUniformLocation(program, "clipPlanes"), camera->GetNear(), camera->GetFar());
+		glUniform1i(glGetUniformLocation(program, "noiseSamples"), noiseSamples);
+
+		DrawQuad();
+
+	if (quality == SHAFTS_QUALITY_LOW)
+	{
+		DrawDenoise();
+	}
+}
+
+/**
+* Blur the light scattering horizontally and then vertically, without blurring through silhouettes.
+* The result is left in the scatter texture of scatterResult index.
+*/
+void LightShafts::DrawDenoise()
+{
+	GLState::Viewport(0, 0, scatterWidth, scatterHeight);
+	GLState::UseProgram(denoiseShader);
+
+		glUniform1i(glGetUniformLocation(denoiseShader, "radius"), denoiseRadius);
+		glUniform1f(glGetUniformLocation(denoiseShader, "depthSigma"), denoiseDepthSigma);
+
+		glm::vec2 directions[2] = { glm::vec2(1.0f / scatterWidth, 0), glm::vec2(0, 1.0f / scatterHeight) };
+		for (int pass = 0; pass < 2; pass++)
+		{
+			// Read the result of the previous pass and render to the other scatter texture.
+			BindTextures(denoiseShader);
+			GLState::BindFramebuffer(GL_DRAW_FRAMEBUFFER, scatterFrameBuffers[1 - scatterResult]);
+			glUniform2fv(glGetUniformLocation(denoiseShader, "direction"), 1, glm::value_ptr(directions[pass]));
+
+			DrawQuad();
+
+			scatterResult = 1 - scatterResult;
+		}
+}
+
+/**
+* Calculate the light scattering with few passes of short radial blur, ping-ponging
+* between scatter textures. The result is left in the scatter texture of scatterResult index.
+* @param camera					- currently using camera
+* @param lightScreenPosition	- position of the light source on screen in (0,1) coordinates
+*/
+void LightShafts::DrawHierarchicalScattering(Camera * camera, const glm::vec2 &lightScreenPosition)
+{
+	/// All passes together take (taps ^ passes) effective taps. Tap n of the original radial blur
+	/// is at distance (1 - n * density / samples) from the light. Here it is exp(-n * scale), so
+	/// pass k can step with (scale * taps ^ k) and distances of all passes multiply into the tap n.
+	/// The scale is chosen so the last tap reaches as far as in the original radial blur.
+	GLfloat effectiveTaps	= glm::pow((GLfloat)hierarchicalTaps, (GLfloat)hierarchicalPasses);
+	GLfloat scale			= -glm::log(1.0f - glm::min(density, 0.999f)) / effectiveTaps;
+
+	/// The decay of tap n is (decay ^ n) and it also splits into the product of decays of all passes.
+	/// Decay and weight are rescaled to keep the same falloff along the ray and the same total
+	/// intensity as the original radial blur with its number of samples.
+	GLfloat tapDecay		= glm::pow(decay, (GLfloat)samples / effectiveTaps);
+	GLfloat tapWeight		= weight * (GLfloat)samples / effectiveTaps;
+
+	GLState::Viewport(0, 0, scatterWidth, scatterHeight);
+	GLState::UseProgram(hierarchicalShader);
+
+		glUniform2fv(glGetUniformLocation(hierarchicalShader, "lightScreenPos"), 1, glm::value_ptr(lightScreenPosition));
+		glUniform2f(glGetUniformLocation(hierarchicalShader, "clipPlanes"), camera->GetNear(), camera->GetFar());
+		glUniform1i(glGetUniformLocation(hierarchicalShader, "taps"), hierarchicalTaps);
+
+		GLfloat stride = 1;
+		for (int pass = 0; pass < hierarchicalPasses; pass++)
+		{
+			// Render to the other scatter texture than the previous pass did.
+			scatterResult = pass % 2;
+			GLState::BindFramebuffer(GL_DRAW_FRAMEBUFFER, scatterFrameBuffers[scatterResult]);
+			BindTextures(hierarchicalShader);
+
+			// The first pass starts one tap away from the pixel (like the original) and the last
+			// one applies the weight and exposure.
+			glUniform1i(glGetUniformLocation(hierarchicalShader, "firstPass"), pass == 0);
+			glUniform1f(glGetUniformLocation(hierarchicalShader, "passScale"), scale * stride);
+			glUniform1f(glGetUniformLocation(hierarchicalShader, "passOffset"), pass == 0 ? scale : 0.0f);
+			glUniform1f(glGetUniformLocation(hierarchicalShader, "passDecay"), glm::pow(tapDecay, stride));
+			glUniform1f(glGetUniformLocation(hierarchicalShader, "passWeight"), pass == hierarchicalPasses - 1 ? tapWeight * exposure : 1.0f);
+
+			DrawQuad();
+
+			stride *= hierarchicalTaps;
+		}
+}
+
+/**
+* Calculate the light scattering by warping the occlusion into polar coordinates around the light,
+* scanning every direction with a recursive filter in compute shader and warping it back.
+* The result is left in the scatter texture of scatterResult index.
+* @param camera					- currently using camera
+* @param lightScreenPosition	- position of the light source on screen in (0,1) coordinates
+*/
+void LightShafts::DrawPolarScattering(Camera * camera, const glm::vec2 &lightScreenPosition)
+{
+	/// Columns of the polar texture are distances from the light growing logarithmically from half
+	/// of the pixel to the farthest screen corner. Tap of the radial blur at (1 - s) of the distance
+	/// is then (-log(1 - s)) columns closer to the light no matter how far the pixel is, so the
+	/// blur is the same filter for every column and every row.
+	glm::vec2 screenSize = glm::vec2(camera->renderWidth, camera->renderHeight);
+	glm::vec2 lightPosition = lightScreenPosition * screenSize;
+	GLfloat maxDistance = 1;
+	maxDistance = glm::max(maxDistance, glm::length(lightPosition));
+	maxDistance = glm::max(maxDistance, glm::length(lightPosition - glm::vec2(screenSize.x, 0)));
+	maxDistance = glm::max(maxDistance, glm::length(lightPosition - glm::vec2(0, screenSize.y)));
+	maxDistance = glm::max(maxDistance, glm::length(lightPosition - screenSize));
+	glm::vec2 radiusRange = glm::vec2(glm::log(0.5f), glm::log(maxDistance) - glm::log(0.5f));
+	GLfloat columnLength = radiusRange.y / polarRadii;
+
+	/// Taps of the radial blur cover the log distance up to -log(1 - density). Spread over it
+	/// the tap n = samples * s / density has the weight (decay ^ n) and takes exp(-v) of dv, so
+	/// the blur becomes the exponential filter exp(-v * (1 + samples * -log(decay) / maxLength))
+	/// with every column weighted by the number of taps it stands for.
+	GLfloat maxLength		= -glm::log(1.0f - glm::min(density, 0.999f));
+	GLfloat falloff			= 1.0f - (GLfloat)samples * glm::log(decay) / maxLength;
+	GLfloat tapDecay		= glm::exp(-falloff * columnLength);
+	GLfloat tapWeight		= (GLfloat)samples / density * columnLength * weight * exposure;
+	int windowLength		= glm::max(1, (int)(maxLength / columnLength + 0.5f));
+
+	// Warp the occlusion into polar coordinates.
+	GLState::BindFramebuffer(GL_DRAW_FRAMEBUFFER, polarFrameBuffer);
+	GLState::Viewport(0, 0, polarRadii, polarAngles);
+	GLState::UseProgram(polarWarpShader);
+
+		BindTextures(polarWarpShader);
+		glUniform2fv(glGetUniformLocation(polarWarpShader, "lightScreenPos"), 1, glm::value_ptr(lightScreenPosition));
+		glUniform2fv(glGetUniformLocation(polarWarpShader, "radiusRange"), 1, glm::value_ptr(radiusRange));
+		glUniform2i(glGetUniformLocation(polarWarpShader, "polarSize"), polarRadii, polarAngles);
+		SetEpipolarUniforms(polarWarpShader, camera, lightScreenPosition);
+
+		DrawQuad();
+
+	/// Scan every row in a separate invocation. Every texel costs the same no matter how many samples there are.
+	GLState::UseProgram(polarScanShader);
+
+		glBindImageTexture(0, polarTextures[0], 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA16F);
+		glBindImageTexture(1, polarTextures[1], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+		glUniform1f(glGetUniformLocation(polarScanShader, "tapDecay"), tapDecay);
+		glUniform1f(glGetUniformLocation(polarScanShader, "tapWeight"), tapWeight);
+		glUniform1i(glGetUniformLocation(polarScanShader, "windowLength"), windowLength);
+		glUniform1f(glGetUniformLocation(polarScanShader, "windowDecay"), glm::pow(tapDecay, (GLfloat)windowLength));
+
+		glDispatchCompute((polarAngles + 63) / 64, 1, 1);
+
+		// Make sure the scan is written before it is sampled as the texture.
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+		glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA16F);
+		glBindImageTexture(1, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+
+	// Warp the light scattering back to the screen.
+	scatterResult = 0;
+	GLState::BindFramebuffer(GL_DRAW_FRAMEBUFFER, scatterFrameBuffers[scatterResult]);
+	GLState::Viewport(0, 0, scatterWidth, scatterHeight);
+	GLState::UseProgram(polarUnwarpShader);
+
+		BindTextures(polarUnwarpShader);
+		glUniform2fv(glGetUniformLocation(polarUnwarpShader, "lightScreenPos"), 1, glm::value_ptr(lightScreenPosition));
+		glUniform2fv(glGetUniformLocation(polarUnwarpShader, "radiusRange"), 1, glm::value_ptr(radiusRange));
+		SetEpipolarUniforms(polarUnwarpShader, camera, lightScreenPosition);
+
+		DrawQuad();
+}
+
+/**
+* Calculate the light scattering in compute shader, tile by tile, and store it in the scatter texture.
+* @param camera					- currently using camera
+* @param lightScreenPosition	- position of the light source on screen in (0,1) coordinates
+*/
+void LightShafts::DrawComputeScattering(Camera * camera, const glm::vec2 &lightScreenPosition)
+{
+	// Every work group calculates the tile of 16x16 texels of the scatter texture.
+	scatterResult = 0;
+	GLState::UseProgram(computeShader);
+
+		BindTextures(computeShader);
+		glBindImageTexture(0, scatterTextures[scatterResult], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+		glUniform2fv(glGetUniformLocation(computeShader, "lightScreenPos"), 1, glm::value_ptr(lightScreenPosition));
+		glUniform2f(glGetUniformLocation(computeShader, "screenSize"), (GLfloat)camera->renderWidth, (GLfloat)camera->renderHeight);
+		glUniform2f(glGetUniformLocation(computeShader, "clipPlanes"), camera->GetNear(), camera->GetFar());
+
+		GLState::BindBufferBase(GL_UNIFORM_BUFFER, 0, UBO);
+			glDispatchCompute((scatterWidth + 15) / 16, (scatterHeight + 15) / 16, 1);
+
+		// Make sure the light scattering is written before it is sampled as the texture.
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+		glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+}
+
+/**
+* Calculate a part of light scattering taps and accumulate them with the reprojected history
+* of previous frames. The result is left in the scatter texture of scatterResult index.
+* @param camera					- currently using camera
+* @param lightScreenPosition	- position of the light source on screen in (0,1) coordinates
+*/
+void LightShafts::DrawTemporalScattering(Camera * camera, const glm::vec2 &lightScreenPosition)
+{
+	/// Light shafts are drawn in the screen space, so when the light moves on the screen
+	/// all of them move with it and no history can be reused.
+	bool resetHistory = (temporalFrame == 0) || (glm::length(lightScreenPosition - previousLightScreenPosition) > temporalLightThreshold);
+
+	// The history is where the camera of the previous frame has seen this pixel. The shader goes from
+	// the current normalized device coordinates to the world and then to the clip space of the previous frame.
+	glm::mat4 viewProjection = camera->GetViewProjectionMatrix();
+
+	// Render to the other scatter texture than the previous frame did, so it can be read as the history.
+	scatterResult = 1 - scatterResult;
+	GLState::BindFramebuffer(GL_DRAW_FRAMEBUFFER, temporalFrameBuffers[scatterResult]);
+	GLState::Viewport(0, 0, scatterWidth, scatterHeight);
+
+	GLState::UseProgram(temporalShader);
+
+		BindTextures(temporalShader);
+		glUniform2fv(glGetUniformLocation(temporalShader, "lightScreenPos"), 1, glm::value_ptr(lightScreenPosition));
+		glUniform2f(glGetUniformLocation(temporalShader, "clipPlanes"), camera->GetNear(), camera->GetFar());
+		glUniformMatrix4fv(glGetUniformLocation(temporalShader, "inverseViewProjection"), 1, GL_FALSE, glm::value_ptr(glm::inverse(viewProjection)));
+		glUniformMatrix4fv(glGetUniformLocation(temporalShader, "previousViewProjection"), 1, GL_FALSE, glm::value_ptr(previousViewProjection));
+		glUniform1i(glGetUniformLocation(temporalShader, "tapOffset"), temporalFrame % temporalFrames);
+		glUniform1i(glGetUniformLocation(temporalShader, "tapStride"), temporalFrames);
+		glUniform1f(glGetUniformLocation(temporalShader, "maxAge"), temporalMaxAge);
+		glUniform1f(glGetUniformLocation(temporalShader, "historyDepthThreshold"), temporalDepthThreshold);
+		glUniform1i(glGetUniformLocation(temporalShader, "resetHistory"), resetHistory);
+
+		DrawQuad();
+
+	// Remember this frame for the next one.
+	temporalFrame++;
+	previousViewProjection = viewProjection;
+	previousLightScreenPosition = lightScreenPosition;
+}
 
-		glBindTexture(GL_TEXTURE_2D_ARRAY, renderTextureArrayColor);
-		glUniform1i(glGetUniformLocation(shader, "tex"), 0);
-		glUniform2fv(glGetUniformLocation(shader, "lightScreenPos"), 1, glm::value_ptr(lightScreenPosition));
+/**
+* Pack the occlusion into the bit mask in compute shader.
+*/
+void LightShafts::DrawOcclusionBitmask()
+{
+	/// The occlusion is black on occluders, the back light where the light passes and white on the light marker.
+	/// Thresholds lie halfway between them, so the bits are exact for hard edges.
+	GLState::UseProgram(bitmaskShader);
+
+		BindTextures(bitmaskShader);
+		glBindImageTexture(0, bitmaskTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG32UI);
+		glUniform1f(glGetUniformLocation(bitmaskShader, "lightThreshold"), backLightColor * 0.5f);
+		glUniform1f(glGetUniformLocation(bitmaskShader, "markerThreshold"), (backLightColor + 1.0f) * 0.5f);
 
-		glBindVertexArray(VAO);
-		glBindBufferBase(GL_UNIFORM_BUFFER, 0, UBO);
-			glDrawArrays(GL_TRIANGLES, 0, 6);
-		glBindBufferBase(GL_UNIFORM_BUFFER, 0, 0);
-		glBindVertexArray(0);
+		glDispatchCompute((bitmaskWidth + 7) / 8, (occlusionHeight + 7) / 8, 1);
 
-		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
-	glUseProgram(0);
+		// Make sure the bit mask is written before it is fetched as the texture.
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+		glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG32UI);
+}
+
+/**
+* Build the min/max pyramid of the occlusion, level by level.
+*/
+void LightShafts::DrawMinMaxPyramid()
+{
+	GLState::BindFramebuffer(GL_DRAW_FRAMEBUFFER, minMaxFrameBuffer);
+	GLState::UseProgram(minMaxShader);
+
+		BindTextures(minMaxShader);
+
+		int width = occlusionWidth;
+		int height = occlusionHeight;
+		for (int level = 0; level < minMaxLevels; level++)
+		{
+			// Every level reads only the previous one, so the level being rendered is never sampled
+			// (the first level reads the occlusion, the last level is out of the way then).
+			int sourceLevel = (level == 0) ? minMaxLevels - 1 : level - 1;
+			GLState::ActiveTexture(GL_TEXTURE10);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, sourceLevel);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, sourceLevel);
+			GLState::ActiveTexture(GL_TEXTURE0);
+
+			glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, minMaxTexture, level);
+			GLState::Viewport(0, 0, width, height);
+			glUniform1i(glGetUniformLocation(minMaxShader, "firstLevel"), level == 0);
+
+			DrawQuad();
+
+			width = glm::max(1, width / 2);
+			height = glm::max(1, height / 2);
+		}
+
+		// Make all levels available for light shafts again.
+		GLState::ActiveTexture(GL_TEXTURE10);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, minMaxLevels - 1);
+		GLState::ActiveTexture(GL_TEXTURE0);
+}
+
+/**
+* Draw light shafts with skipping once more, only to count pixels where they differ from the brute force loop.
+* The count is added to profiler counters.
+*/
+void LightShafts::ValidateSkipping()
+{
+	// Pixels matching the brute force loop are discarded, so the query counts only the wrong ones.
+	// Any scatter texture can be overwritten here, skip mode doesn't use them.
+	GLState::BindFramebuffer(GL_DRAW_FRAMEBUFFER, scatterFrameBuffers[0]);
+	GLState::Viewport(0, 0, scatterWidth, scatterHeight);
+	GLState::UseProgram(skipShader);
+
+		glUniform1i(glGetUniformLocation(skipShader, "validate"), true);
+		BindTextures(skipShader);
+
+		glBeginQuery(GL_SAMPLES_PASSED, skipValidateQuery);
+			DrawQuad();
+		glEndQuery(GL_SAMPLES_PASSED);
+
+	// This is only for checking, so wait for the result.
+	GLuint wrongPixels = 0;
+	glGetQueryObjectuiv(skipValidateQuery, GL_QUERY_RESULT, &wrongPixels);
+	ENGINE->profiler->AddCounter("Skip mismatches", wrongPixels);
+
+	// Skipping must give the same light shafts, so any difference is a failure, with or without the profiler.
+	if (wrongPixels > 0)
+	{
+		printf("Skip validation failed: %u pixels differ from the brute force loop.\n", wrongPixels);
+		ENGINE->FailEngine();
+	}
+	GLState::BindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+}
+
+/**
+* Copy the final scene from the resolve texture to the screen, dithering and upscaling it when needed.
+*/
+void LightShafts::DrawResolve()
+{
+	// The screen has the size of the final image, which can be bigger than render targets.
+	Camera * camera = ENGINE->scene->camera;
+	GLState::BindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	GLState::Viewport(0, 0, camera->outputWidth, camera->outputHeight);
+	GLState::UseProgram(resolveShader);
+
+		BindTextures(resolveShader);
+		glUniform1i(glGetUniformLocation(resolveShader, "dither"), dither);
+
+		DrawQuad();
+}
+
+/**
+* Draw adaptive light shafts once more, only to count the average number of taps they take.
+* The count is added to profiler counters.
+*/
+void LightShafts::CountAdaptiveTaps()
+{
+	// Every pixel outputs its number of taps divided by samples.
+	// Any scatter texture can be overwritten here, adaptive mode doesn't use them.
+	GLState::BindFramebuffer(GL_FRAMEBUFFER, scatterFrameBuffers[0]);
+	GLState::Viewport(0, 0, scatterWidth, scatterHeight);
+	GLState::UseProgram(adaptiveShader);
+
+		glUniform1i(glGetUniformLocation(adaptiveShader, "countTaps"), true);
+		BindTextures(adaptiveShader);
+		DrawQuad();
+
+	// This is only for checking, so wait for the result and average it here.
+	std::vector<GLfloat> taps(scatterWidth * scatterHeight);
+	glReadPixels(0, 0, scatterWidth, scatterHeight, GL_RED, GL_FLOAT, &taps[0]);
+	GLState::BindFramebuffer(GL_FRAMEBUFFER, 0);
+	double sum = 0;
+	for (size_t i = 0; i < taps.size(); i++)
+	{
+		sum += taps[i];
+	}
+	double average = sum / taps.size();
+	ENGINE->profiler->AddCounter("Average taps", average * samples);
+	ENGINE->profiler->AddCounter("Taps saved %", 100.0 * (1.0 - average));
+}
+
+/**
+* Draw cone light shafts and the radial blur once more, one after another into the same target,
+* only to measure how much time cone taps save. Results are read a few frames late without waiting
+* and added to profiler counters.
+* @param lightScreenPosition	- position of the light source on screen in (0,1) coordinates
+* @param intensity				- intensity of light shafts
+*/
+void LightShafts::MeasureConeSaving(const glm::vec2 &lightScreenPosition, GLfloat intensity)
+{
+	// Collect results that are already available from the oldest ones.
+	for (int i = 0; i < SHAFTS_CONE_QUERIES; i++)
+	{
+		int index = (coneQueryNext + i) % SHAFTS_CONE_QUERIES;
+		if (coneQueryIssued[index] == false)
+		{
+			continue;
+		}
+		GLuint available = 0;
+		glGetQueryObjectuiv(coneQueries[index][2], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available == 0)
+		{
+			break;
+		}
+		GLuint64 times[3];
+		for (int j = 0; j < 3; j++)
+		{
+			glGetQueryObjectui64v(coneQueries[index][j], GL_QUERY_RESULT, &times[j]);
+		}
+		coneQueryIssued[index] = false;
+
+		double coneTime = (times[1] - times[0]) / 1000000.0;
+		double radialTime = (times[2] - times[1]) / 1000000.0;
+		ENGINE->profiler->AddCounter("Cone taps ms", coneTime);
+		ENGINE->profiler->AddCounter("Radial taps ms", radialTime);
+		if (radialTime > 0)
+		{
+			ENGINE->profiler->AddCounter("Cone time saved %", 100.0 * (1.0 - coneTime / radialTime));
+		}
+	}
+
+	// When all timestamps still wait for results this frame is not measured.
+	if (coneQueryIssued[coneQueryNext] == true)
+	{
+		return;
+	}
+
+	/// Both draws go to the same scatter texture (cone mode doesn't use it) with nothing in between,
+	/// so the difference of timestamps is the time of each of them, with the occlusion reads of all taps
+	/// (coarse mip levels of cone taps read fewer bytes, which shows in the time too).
+	GLuint * queries = coneQueries[coneQueryNext];
+	GLState::BindFramebuffer(GL_DRAW_FRAMEBUFFER, scatterFrameBuffers[0]);
+	GLState::Viewport(0, 0, scatterWidth, scatterHeight);
+
+	// Uniforms of the cone shader were set by the final scene.
+	glQueryCounter(queries[0], GL_TIMESTAMP);
+	GLState::UseProgram(coneShader);
+
+		BindTextures(coneShader);
+		DrawQuad();
+
+	glQueryCounter(queries[1], GL_TIMESTAMP);
+	GLState::UseProgram(radialShader);
+
+		BindTextures(radialShader);
+		glUniform2fv(glGetUniformLocation(radialShader, "lightScreenPos"), 1, glm::value_ptr(lightScreenPosition));
+		glUniform1f(glGetUniformLocation(radialShader, "intensity"), intensity);
+		DrawQuad();
+
+	glQueryCounter(queries[2], GL_TIMESTAMP);
+	coneQueryIssued[coneQueryNext] = true;
+	coneQueryNext = (coneQueryNext + 1) % SHAFTS_CONE_QUERIES;
+}
+
+/**
+* Classify tiles of the screen into tiles that can have light shafts and tiles that can't,
+* filling the indirect draw commands and lists of both of them.
+* @param camera					- currently using camera
+* @param lightScreenPosition	- position of the light source on screen in (0,1) coordinates
+*/
+void LightShafts::ClassifyTiles(Camera * camera, const glm::vec2 &lightScreenPosition)
+{
+	// Both lists start empty, every command draws 6 vertices of the quad for every tile in its list.
+	GLuint commands[8] = { 6, 0, 0, 0, 6, 0, 0, 0 };
+	GLState::BindBuffer(GL_SHADER_STORAGE_BUFFER, tileCommandsBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(commands), commands);
+	GLState::BindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	// Find the brightest occlusion of every tile, one work group per tile.
+	GLState::UseProgram(tileReduceShader);
+
+		BindTextures(tileReduceShader);
+		glBindImageTexture(0, tileTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R16F);
+		glUniform2f(glGetUniformLocation(tileReduceShader, "screenSize"), (GLfloat)camera->renderWidth, (GLfloat)camera->renderHeight);
+
+		glDispatchCompute(tilesX, tilesY, 1);
+
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+	// Put every tile into one of lists, one invocation per tile.
+	GLState::UseProgram(tileClassifyShader);
+
+		glBindImageTexture(0, tileTexture, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R16F);
+		GLState::BindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, tileCommandsBuffer);
+		GLState::BindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, tileListsBuffer);
+		glUniform2fv(glGetUniformLocation(tileClassifyShader, "lightScreenPos"), 1, glm::value_ptr(lightScreenPosition));
+		glUniform2f(glGetUniformLocation(tileClassifyShader, "screenTiles"), camera->renderWidth / 16.0f, camera->renderHeight / 16.0f);
+		glUniform1i(glGetUniformLocation(tileClassifyShader, "tileCount"), tilesX * tilesY);
+
+		GLState::BindBufferBase(GL_UNIFORM_BUFFER, 0, UBO);
+			glDispatchCompute((tilesX + 7) / 8, (tilesY + 7) / 8, 1);
+
+		// Make sure commands and lists are written before they are used by draws.
+		glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+		glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R16F);
+		GLState::BindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+		GLState::BindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, 0);
+
+	// Reading the number of tiles waits for the GPU, so do it only when it is printed.
+	if (ENGINE->profiler->enabled)
+	{
+		GLState::BindBuffer(GL_SHADER_STORAGE_BUFFER, tileCommandsBuffer);
+		glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(commands), commands);
+		GLState::BindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		ENGINE->profiler->AddCounter("Lit tiles %", 100.0 * commands[1] / (tilesX * tilesY));
+	}
+}
+
+/**
+* Draw the quad on every tile of the list with currently used program.
+* @param program	- Handler of the currently used program
+* @param list		- Index of the list of tiles (0 - tiles with light shafts, 1 - tiles without them)
+*/
+void LightShafts::DrawTiles(GLuint program, int list)
+{
+	glUniform1i(glGetUniformLocation(program, "listOffset"), list * tilesX * tilesY);
+	glUniform2fv(glGetUniformLocation(program, "tileScale"), 1, glm::value_ptr(tileScale));
+
+	GLState::BindVertexArray(VAO);
+	GLState::BindBufferBase(GL_UNIFORM_BUFFER, 0, UBO);
+	GLState::BindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, tileListsBuffer);
+	GLState::BindBuffer(GL_DRAW_INDIRECT_BUFFER, tileCommandsBuffer);
+		glDrawArraysIndirect(GL_TRIANGLES, (const void *)(sizeof(GLuint) * 4 * list));
+	GLState::BindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	GLState::BindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, 0);
+}
+
+/**
+* Bind all textures used by light shafts shaders and tell the given program where they are.
+* 0 - normal scene color, 1 - normal scene depth, 2 - epipolar lines, 3 - light scattering,
+* 4 - the other light scattering (previous pass of ping-pong), 5 - light scattering in polar coordinates,
+* 6 - age of the history of the other light scattering, 7 - blue noise, 8 - occlusion, 9 - occlusion bit mask,
+* 10 - min/max pyramid of the occlusion.
+* The occlusion has a single channel, so the color of the light is given with it.
+* @param program - Handler of the program using the textures
+*/
+void LightShafts::BindTextures(GLuint program)
+{
+	GLState::ActiveTexture(GL_TEXTURE1);
+	GLState::BindTexture(GL_TEXTURE_2D_ARRAY, renderTextureArrayDepth);
+	GLState::ActiveTexture(GL_TEXTURE2);
+	GLState::BindTexture(GL_TEXTURE_2D, epipolarTexture);
+	GLState::ActiveTexture(GL_TEXTURE3);
+	GLState::BindTexture(GL_TEXTURE_2D, scatterTextures[scatterResult]);
+	GLState::ActiveTexture(GL_TEXTURE4);
+	GLState::BindTexture(GL_TEXTURE_2D, scatterTextures[1 - scatterResult]);
+	GLState::ActiveTexture(GL_TEXTURE5);
+	GLState::BindTexture(GL_TEXTURE_2D, polarTextures[1]);
+	GLState::ActiveTexture(GL_TEXTURE6);
+	GLState::BindTexture(GL_TEXTURE_2D, temporalAgeTextures[1 - scatterResult]);
+	GLState::ActiveTexture(GL_TEXTURE7);
+	GLState::BindTexture(GL_TEXTURE_2D, noiseTexture);
+	GLState::ActiveTexture(GL_TEXTURE8);
+	GLState::BindTexture(GL_TEXTURE_2D, occlusionTexture);
+	GLState::ActiveTexture(GL_TEXTURE9);
+	GLState::BindTexture(GL_TEXTURE_2D, bitmaskTexture);
+	GLState::ActiveTexture(GL_TEXTURE10);
+	GLState::BindTexture(GL_TEXTURE_2D, minMaxTexture);
+	GLState::ActiveTexture(GL_TEXTURE11);
+	GLState::BindTexture(GL_TEXTURE_2D, resolveTexture);
+	GLState::ActiveTexture(GL_TEXTURE0);
+	GLState::BindTexture(GL_TEXTURE_2D_ARRAY, renderTextureArrayColor);
+
+	// Uniforms that are not used by the program have -1 location and are ignored.
+	glUniform1i(glGetUniformLocation(program, "tex"), 0);
+	glUniform1i(glGetUniformLocation(program, "depthTex"), 1);
+	glUniform1i(glGetUniformLocation(program, "epipolarTex"), 2);
+	glUniform1i(glGetUniformLocation(program, "scatterTex"), 3);
+	glUniform1i(glGetUniformLocation(program, "previousPassTex"), 4);
+	glUniform1i(glGetUniformLocation(program, "polarTex"), 5);
+	glUniform1i(glGetUniformLocation(program, "historyAgeTex"), 6);
+	glUniform1i(glGetUniformLocation(program, "noiseTex"), 7);
+	glUniform1i(glGetUniformLocation(program, "occlusionTex"), 8);
+	glUniform1i(glGetUniformLocation(program, "bitmaskTex"), 9);
+	glUniform1i(glGetUniformLocation(program, "minMaxTex"), 10);
+	glUniform1i(glGetUniformLocation(program, "resolveTex"), 11);
+	glUniform3fv(glGetUniformLocation(program, "lightColor"), 1, glm::value_ptr(lightColor));
+}
+
+/**
+* Draw the quad filling whole render target with currently used program.
+*/
+void LightShafts::DrawQuad()
+{
+	GLState::BindVertexArray(VAO);
+	GLState::BindBufferBase(GL_UNIFORM_BUFFER, 0, UBO);
+		glDrawArrays(GL_TRIANGLES, 0, 6);
+}
+
+/**
+* Copy the normal scene to the screen without any light shafts.
+* @param camera - currently using camera
+*/
+void LightShafts::CopyNormalScene(Camera * camera)
+{
+	// With the lower render scale the normal scene is upscaled to the size of the final image.
+	GLenum filter = (camera->renderWidth != camera->outputWidth || camera->renderHeight != camera->outputHeight) ? GL_LINEAR : GL_NEAREST;
+	GLState::BindFramebuffer(GL_READ_FRAMEBUFFER, normalFrameBuffer);
+	GLState::BindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(0, 0, camera->renderWidth, camera->renderHeight, 0, 0, camera->outputWidth, camera->outputHeight, GL_COLOR_BUFFER_BIT, filter);
+	GLState::BindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
+
+/**
+* Set the uniforms describing epipolar lines for the given program.
+* Rows of the polar texture are going in the same directions, so polar shaders use them too.
+* @param program				- Handler of the program using the uniforms
+* @param camera					- currently using camera
+* @param lightScreenPosition	- position of the light source on screen in (0,1) coordinates
+*/
+void LightShafts::SetEpipolarUniforms(GLuint program, Camera * camera, const glm::vec2 &lightScreenPosition)
+{
+	glm::vec2 screenSize = glm::vec2(camera->renderWidth, camera->renderHeight);
+	glm::vec2 lightPosition = lightScreenPosition * screenSize;
+
+	/// When the light is on the screen lines are going in every direction. Otherwise they
+	/// only have to cover the angle in which the screen is seen from the light position.
+	glm::vec2 angleRange = glm::vec2(-glm::pi<GLfloat>(), glm::two_pi<GLfloat>());
+	bool wrapLines = true;
+	if (lightScreenPosition.x < 0 || lightScreenPosition.x > 1 || lightScreenPosition.y < 0 || lightScreenPosition.y > 1)
+	{
+		// Measure angles of all screen corners relatively to the first one, so there is no jump between -PI and PI.
+		glm::vec2 corners[4] = { glm::vec2(0, 0), glm::vec2(screenSize.x, 0), glm::vec2(0, screenSize.y), screenSize };
+		GLfloat baseAngle = atan2(corners[0].y - lightPosition.y, corners[0].x - lightPosition.x);
+		GLfloat minAngle = 0;
+		GLfloat maxAngle = 0;
+		for (int i = 1; i < 4; i++)
+		{
+			GLfloat angle = atan2(corners[i].y - lightPosition.y, corners[i].x - lightPosition.x) - baseAngle;
+			if (angle > glm::pi<GLfloat>())		angle -= glm::two_pi<GLfloat>();
+			if (angle < -glm::pi<GLfloat>())	angle += glm::two_pi<GLfloat>();
+			minAngle = glm::min(minAngle, angle);
+			maxAngle = glm::max(maxAngle, angle);
+		}
+		angleRange = glm::vec2(baseAngle + minAngle, maxAngle - minAngle);
+		wrapLines = false;
+	}
+
+	glUniform2fv(glGetUniformLocation(program, "screenSize"), 1, glm::value_ptr(screenSize));
+	glUniform2fv(glGetUniformLocation(program, "angleRange"), 1, glm::value_ptr(angleRange));
+	glUniform2f(glGetUniformLocation(program, "clipPlanes"), camera->GetNear(), camera->GetFar());
+	glUniform2i(glGetUniformLocation(program, "epipolarSize"), epipolarSamples, epipolarLines);
+	glUniform1i(glGetUniformLocation(program, "wrapLines"), wrapLines);
 }
 
 /**
@@ -252,9 +2104,107 @@ LightShafts::~LightShafts()
 {
 	Shaders::DeleteShaders(shader);
 	glDeleteProgram(shader);
-	glDeleteBuffers(2, VBO);
-	glDeleteBuffers(1, &UBO);
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteTextures(1, &renderTextureArrayColor);
-	glDeleteTextures(1, &renderTextureArrayDepth);
+	Shaders::DeleteShaders(upsampleShader);
+	glDeleteProgram(upsampleShader);
+	Shaders::DeleteShaders(denoiseShader);
+	glDeleteProgram(denoiseShader);
+	Shaders::DeleteShaders(multiLightShader);
+	glDeleteProgram(multiLightShader);
+	Shaders::DeleteShaders(resolveShader);
+	glDeleteProgram(resolveShader);
+	if (mode == SHAFTS_MODE_EPIPOLAR)
+	{
+		Shaders::DeleteShaders(epipolarShader);
+		glDeleteProgram(epipolarShader);
+		Shaders::DeleteShaders(epipolarCompositeShader);
+		glDeleteProgram(epipolarCompositeShader);
+	}
+	if (mode == SHAFTS_MODE_HIERARCHICAL)
+	{
+		Shaders::DeleteShaders(hierarchicalShader);
+		glDeleteProgram(hierarchicalShader);
+	}
+	if (mode == SHAFTS_MODE_TEMPORAL)
+	{
+		Shaders::DeleteShaders(temporalShader);
+		glDeleteProgram(temporalShader);
+	}
+	if (mode == SHAFTS_MODE_CONE)
+	{
+		Shaders::DeleteShaders(coneShader);
+		glDeleteProgram(coneShader);
+		if (ENGINE->profiler->enabled)
+		{
+			glDeleteQueries(SHAFTS_CONE_QUERIES * 3, &coneQueries[0][0]);
+		}
+	}
+	if (depthOcclusion)
+	{
+		Shaders::DeleteShaders(depthOcclusionShader);
+		glDeleteProgram(depthOcclusionShader);
+	}
+	if (mode == SHAFTS_MODE_POLAR)
+	{
+		Shaders::DeleteShaders(polarWarpShader);
+		glDeleteProgram(polarWarpShader);
+		Shaders::DeleteShaders(polarScanShader);
+		glDeleteProgram(polarScanShader);
+		Shaders::DeleteShaders(polarUnwarpShader);
+		glDeleteProgram(polarUnwarpShader);
+	}
+	if (mode == SHAFTS_MODE_COMPUTE)
+	{
+		Shaders::DeleteShaders(computeShader);
+		glDeleteProgram(computeShader);
+	}
+	if (mode == SHAFTS_MODE_SKIP)
+	{
+		Shaders::DeleteShaders(minMaxShader);
+		glDeleteProgram(minMaxShader);
+		Shaders::DeleteShaders(skipShader);
+		glDeleteProgram(skipShader);
+		glDeleteQueries(1, &skipValidateQuery);
+	}
+	if (mode == SHAFTS_MODE_ADAPTIVE)
+	{
+		Shaders::DeleteShaders(adaptiveShader);
+		glDeleteProgram(adaptiveShader);
+	}
+	if (mode == SHAFTS_MODE_BITMASK)
+	{
+		Shaders::DeleteShaders(bitmaskShader);
+		glDeleteProgram(bitmaskShader);
+		Shaders::DeleteShaders(bitmaskCompositeShader);
+		glDeleteProgram(bitmaskCompositeShader);
+	}
+	if (tileClassification)
+	{
+		Shaders::DeleteShaders(tileReduceShader);
+		glDeleteProgram(tileReduceShader);
+		Shaders::DeleteShaders(tileClassifyShader);
+		glDeleteProgram(tileClassifyShader);
+		Shaders::DeleteShaders(tileShader);
+		glDeleteProgram(tileShader);
+		Shaders::DeleteShaders(tileCopyShader);
+		glDeleteProgram(tileCopyShader);
+		GLState::DeleteBuffers(1, &tileCommandsBuffer);
+	}
+	for (std::map<std::string, GLuint>::iterator variant = programVariants.begin(); variant != programVariants.end(); variant++)
+	{
+		Shaders::DeleteShaders(variant->second);
+		glDeleteProgram(variant->second);
+	}
+	GLState::DeleteBuffers(2, VBO);
+	GLState::DeleteBuffers(1, &UBO);
+	GLState::DeleteBuffers(1, &lightsUBO);
+	GLState::DeleteVertexArrays(1, &VAO);
+	DeleteTargets();
+	ENGINE->scene->targetPool->Release(epipolarTexture);
+	ENGINE->scene->targetPool->Release(polarTextures[0]);
+	ENGINE->scene->targetPool->Release(polarTextures[1]);
+	GLState::DeleteTextures(1, &noiseTexture);
+	GLState::DeleteFramebuffers(1, &normalFrameBuffer);
+	glDeleteQueries(4, &markerQueries[0][0]);
+	GLState::DeleteFramebuffers(1, &epipolarFrameBuffer);
+	GLState::DeleteFramebuffers(1, &polarFrameBuffer);
 }
\ No newline at end of file
@@ -10,15 +10,61 @@
 * (c) 2014 Damian Nowakowski
 */
 
+#include <vector>
+#include <map>
+#include <string>
 #include "glm/glm.hpp"
 #include "Engine.h"
 
 // Define the uniform buffer elements of light shafts shader
 #define SHAFTS_UNIFORM_SIZE 5
 
+// Define the maximum number of lights calculated together (must be the same as MAX_LIGHTS in shaders)
+#define SHAFTS_MAX_LIGHTS 64
+
+// Define the number of timestamp query sets comparing cone taps with the radial blur, so they are read without waiting
+#define SHAFTS_CONE_QUERIES 4
+
+/**
+* Available methods of rendering the light shafts.
+*/
+enum ShaftsMode
+{
+	SHAFTS_MODE_RADIAL,		///< Radial blur calculated for every pixel of the screen
+	SHAFTS_MODE_EPIPOLAR,	///< Radial blur calculated along epipolar lines and interpolated between them
+	SHAFTS_MODE_HIERARCHICAL,	///< Radial blur calculated in few short passes with growing step length
+	SHAFTS_MODE_POLAR,			///< Radial blur calculated as a recursive filter along rows of occlusion warped into polar coordinates
+	SHAFTS_MODE_COMPUTE,		///< Radial blur calculated in compute shader for tiles of pixels sharing the loaded occlusion
+	SHAFTS_MODE_TEMPORAL,		///< Radial blur calculated with a part of taps every frame and accumulated over frames
+	SHAFTS_MODE_CONE,			///< Radial blur with few taps reading coarser mip levels of the occlusion further from the pixel
+	SHAFTS_MODE_BITMASK,		///< Radial blur reading the occlusion packed into bits, 32 texels with one fetch
+	SHAFTS_MODE_SKIP,			///< Radial blur summing at once all taps where the min/max pyramid says the occlusion doesn't change
+	SHAFTS_MODE_ADAPTIVE		///< Radial blur taking as many taps as the length and the decay of the ray need
+};
+
+/**
+* Quality tiers of the light scattering in radial mode.
+*/
+enum ShaftsQuality
+{
+	SHAFTS_QUALITY_HIGH,	///< All samples are calculated for every pixel
+	SHAFTS_QUALITY_LOW		///< Few samples jittered with blue noise, then denoised
+};
+
+/**
+* Format of the render target selectable in the configuration.
+*/
+struct ShaftsFormat
+{
+	const char *name;		///< Name of the format in the configuration
+	GLenum internalFormat;	///< Internal format of the texture
+	int bytes;				///< Size of one texel in bytes
+};
+
 // Predefine classes for visibility
 class Camera;
 class Light;
+class FrameGraph;
 
 class LightShafts
 {
@@ -37,46 +83,466 @@ public:
 	GLfloat weight;
 	GLfloat backLightColor;
 
+	ShaftsMode mode;				///< Method of rendering the light shafts
+	GLfloat offscreenFadeDistance;	///< Distance of the light outside of the screen (in (0,1) coordinates) at which light shafts fade out
+	bool occlusionQuery;			///< True to skip light shafts on GPU when the light marker is fully hidden
+	bool occlusionFade;				///< True to scale light shafts by the visible part of the light marker (one frame late)
+	int epipolarLines;				///< Number of epipolar lines (used in epipolar mode)
+	int epipolarSamples;			///< Number of samples on every epipolar line (used in epipolar mode)
+	GLfloat epipolarDepthThreshold;	///< Relative depth difference above which the pixel is not interpolated from lines
+	int downsample;					///< How many times the resolution of light scattering is smaller than the screen (1, 2 or 4)
+	GLfloat downsampleDepthSigma;	///< Relative depth difference at which the upsampled texel loses most of its weight
+	int hierarchicalPasses;			///< Number of passes of the hierarchical radial blur
+	int hierarchicalTaps;			///< Number of taps in every pass of the hierarchical radial blur
+	int polarAngles;				///< Number of directions from the light in the polar texture (used in polar mode)
+	int polarRadii;					///< Number of distances from the light in the polar texture (used in polar mode)
+	int temporalFrames;				///< Number of frames over which all taps are calculated (used in temporal mode)
+	GLfloat temporalMaxAge;			///< Maximum number of frames averaged in the history
+	GLfloat temporalLightThreshold;	///< Movement of the light on screen (in (0,1) coordinates) above which the history is dropped
+	GLfloat temporalDepthThreshold;	///< Relative depth difference above which the history of a pixel is rejected (0 - never)
+	ShaftsQuality quality;			///< Quality tier of the light scattering (used in radial mode)
+	int noiseSamples;				///< Number of samples calculated in low quality
+	int denoiseRadius;				///< Number of texels on each side taken by the denoise in low quality
+	GLfloat denoiseDepthSigma;		///< Relative depth difference at which the denoised texel loses most of its weight
+	GLfloat lightCullThreshold;		///< Screen contribution of the light below which it is skipped (with many lights)
+	int minLightSamples;			///< Minimum number of samples calculated for every light (with many lights)
+	int coneSamples;				///< Number of taps of the radial blur (used in cone mode)
+	GLfloat coneLodBias;			///< Bias added to the mip level of every tap (used in cone mode)
+	int occlusionDownsample;		///< How many times the resolution of the occlusion is smaller than the screen (1, 2 or 4)
+	bool skipValidate;				///< True to count pixels where skipping differs from the brute force loop (used in skip mode)
+	bool tileClassification;		///< True to calculate light shafts only on tiles whose rays can reach the light (used in radial mode)
+	int adaptiveMinSamples;			///< The smallest number of taps of the shortest rays (used in adaptive mode)
+	GLfloat adaptiveEpsilon;		///< Contribution of the rest of taps below which the ray stops (used in adaptive mode)
+	bool dither;					///< True to dither the final scene when it is rounded to the 8-bit screen
+	bool singlePass;				///< True to draw the normal scene and the occlusion in one pass to two attachments
+	bool depthOcclusion;			///< True to make the occlusion from the depth of the normal scene instead of drawing it
+
 	/**
 	* Update the uniform buffer with new light shafts parameters.
 	*/
 	void UpdateUniformBuffer();
 
-	/// Always render using functions below in that order:
-	/// 1 - StartDrawingOcclusion
-	/// 2 - StartDrawingNormal
+	/**
+	* Switch the quality tier of the radial blur. Programs specialized for the tier are
+	* compiled only the first time it is used, after that they are taken from the cache.
+	* @param newQuality - quality tier to use from now on
+	*/
+	void SetQuality(ShaftsQuality newQuality);
+
+	/**
+	* Declare render targets of the normal scene and the occlusion in the frame graph.
+	* The color and the depth of the normal scene and the depth of the occlusion are created
+	* by the graph, the occlusion (with its mip levels and other textures made from it) stays here.
+	* @param graph - the frame graph of the scene
+	* @param scene - the current scene
+	*/
+	void DeclareTargets(FrameGraph * graph, Scene * scene);
+
+	/**
+	* Take textures created by the compiled frame graph.
+	* @param graph - the compiled frame graph of the scene
+	*/
+	void AcquireTargets(FrameGraph * graph);
+
+	/**
+	* Make render targets of the size of the screen again for the current render size of the camera
+	* (after the window or the render scale changed). The old ones go back to the render target pool first,
+	* so the new ones can be taken from it. Accumulated history is lost, so it starts again.
+	*/
+	void Resize();
+
+	int sceneColorTarget;		///< Frame graph resource of the normal scene color
+	int sceneDepthTarget;		///< Frame graph resource of the normal scene depth
+	int occlusionTarget;		///< Frame graph resource of the occlusion
+	int occlusionDepthTarget;	///< Frame graph resource of the occlusion depth
+	int screenTarget;			///< Frame graph resource of the screen
+
+	/// Functions below are called by passes of the frame graph (the graph binds and clears their targets):
+	/// 1 - DrawLightMarkers (after drawing the occlusion scene)
+	/// 2 - DrawDepthOcclusion (after drawing the normal scene, instead of the occlusion scene)
 	/// 3 - DrawLightShafts
 	/*
-	* Run this before rendering the occlusion. The occlusion will be saved
-	* to texture and used to compose the light shafts effect.
-	* @param scene - the current scene
+	* Run this after rendering the occlusion scene. It draws light markers into the occlusion.
+	* With a single light it counts how much of its marker is visible, so light shafts can be
+	* skipped when it is fully hidden.
+	* @param lights	- all point lights making light shafts
 	*/
-	void StartDrawingOcclusion(Scene * scene);
+	void DrawLightMarkers(const std::vector<Light*> &lights);
 
 	/*
-	* Run this before rendering the normal scene. This scene will be saved
-	* to texture and used to compose the light shafts effect.
+	* Run this after rendering the normal scene instead of rendering the occlusion scene. It makes the occlusion
+	* from the depth of the normal scene: the sky lets the light pass, the geometry doesn't, and discs
+	* of light markers are added in front of the geometry.
 	* @param scene - the current scene
 	*/
-	void StartDrawingNormal(Scene * scene);
+	void DrawDepthOcclusion(Scene * scene);
 
 	/*
 	* After getting occlusion texture and normal scene texture run this method.
 	* It will compose previous textures and render the final scene on the screen.
 	* @param camera - currently using camera
-	* @param light	- currently using point light
+	* @param lights	- all point lights making light shafts
 	*/
-	void DrawLightShafts(Camera * camera, Light * light);
+	void DrawLightShafts(Camera * camera, const std::vector<Light*> &lights);
 
 private:
 
+	/**
+	* Create the program that draws the quad filling whole screen with the given fragment shader.
+	* The program shares the vertex attributes locations and the uniform buffer binding with
+	* the main light shafts shader so the same buffers can be used.
+	* @param program		- Handler of the program to create
+	* @param path			- Path to the fragment shader file
+	* @param vertexPath		- Path to the vertex shader file
+	* @param defines		- Lines of #define directives specializing the fragment shader
+	*/
+	void CreateQuadProgram(GLuint &program, const char *path, const char *vertexPath = "data/shaders/light_shafts_vs.glsl", const std::string &defines = "");
+
+	/**
+	* Get the quad program with the given fragment shader specialized with the given defines.
+	* It is created only once for every set of defines and taken from the cache after that.
+	* @param path		- Path to the fragment shader file
+	* @param defines	- Lines of #define directives specializing the fragment shader
+	* @returns handler of the program
+	*/
+	GLuint GetProgramVariant(const char *path, const std::string &defines);
+
+	/**
+	* Create the program with the given compute shader. If the program uses light shafts
+	* parameters they are bound to the same uniform buffer as in the main light shafts shader.
+	* @param program	- Handler of the program to create
+	* @param path		- Path to the compute shader file
+	*/
+	void CreateComputeProgram(GLuint &program, const char *path);
+
+	/**
+	* Create render targets of the size of the screen (of the render size of the camera). Their textures
+	* are taken from the render target pool, so the ones made again with a size that was used recently
+	* (the window resized back, the render scale going up and down) are not created by the driver again.
+	*/
+	void CreateTargets();
+
+	/**
+	* Give render targets of the size of the screen back to the render target pool (and delete the rest of them).
+	*/
+	void DeleteTargets();
+
+	/**
+	* Create the texture with the frame buffer rendering to it.
+	* @param texture		- Handler of the texture to create
+	* @param frameBuffer	- Handler of the frame buffer to create
+	* @param internalFormat	- Format of the texture
+	* @param width			- Width of the texture
+	* @param height			- Height of the texture
+	* @param filter			- Filter used when the texture is sampled
+	* @param levels			- Number of mip levels of the texture
+	*/
+	void CreateRenderTarget(GLuint &texture, GLuint &frameBuffer, GLenum internalFormat, int width, int height, GLenum filter, int levels = 1);
+
+	/**
+	* Take the texture without any frame buffer (for example to write it from compute shader) from the render target pool.
+	* @param texture		- Handler of the texture to create
+	* @param internalFormat	- Format of the texture
+	* @param width			- Width of the texture
+	* @param height			- Height of the texture
+	* @param filter			- Filter used when the texture is sampled
+	* @param levels			- Number of mip levels of the texture
+	*/
+	void CreateTexture(GLuint &texture, GLenum internalFormat, int width, int height, GLenum filter, int levels = 1);
+
+	/**
+	* Count mip levels of the texture down to 1x1.
+	* @param width	- Width of the texture
+	* @param height	- Height of the texture
+	* @return Number of mip levels
+	*/
+	int CountMipLevels(int width, int height);
+
+	/**
+	* Bind all textures used by light shafts shaders and tell the given program where they are.
+	* 0 - normal scene color, 1 - normal scene depth, 2 - epipolar lines, 3 - light scattering,
+	* 4 - the other light scattering (previous pass of ping-pong), 5 - light scattering in polar coordinates,
+	* 6 - age of the history of the other light scattering, 7 - blue noise, 8 - occlusion, 9 - occlusion bit mask,
+	* 10 - min/max pyramid of the occlusion.
+	* The occlusion has a single channel, so the color of the light is given with it.
+	* @param program - Handler of the program using the textures
+	*/
+	void BindTextures(GLuint program);
+
+	/**
+	* Draw the quad filling whole render target with currently used program.
+	*/
+	void DrawQuad();
+
+	/**
+	* Copy the normal scene to the screen without any light shafts.
+	* @param camera - currently using camera
+	*/
+	void CopyNormalScene(Camera * camera);
+
+	/**
+	* Calculate the intensity of light shafts of the light from its position on the screen. They fade out
+	* when the light leaves the screen and disappear when it is behind the camera.
+	* @param camera					- currently using camera
+	* @param light					- point light making light shafts
+	* @param lightScreenPosition	- returns position of the light source on screen in (0,1) coordinates
+	* @param lightOnScreen			- returns true when the light is inside of the screen
+	* @returns intensity of light shafts (0 - none, 1 - full)
+	*/
+	GLfloat GetScreenIntensity(Camera * camera, Light * light, glm::vec2 &lightScreenPosition, bool &lightOnScreen);
+
+	/**
+	* Find the disc of the light marker on the screen, the same way the marker shader draws it.
+	* @param camera	- currently using camera
+	* @param light	- point light with the marker
+	* @param marker	- returns the disc of the marker (xy - center, zw - radius) in (0,1) coordinates
+	* @param depth	- returns the depth of the marker (the same as in the depth texture)
+	* @returns false when the light is behind the camera and has no marker
+	*/
+	bool GetMarkerDisc(Camera * camera, Light * light, glm::vec4 &marker, GLfloat &depth);
+
+	/**
+	* Cull lights that don't make visible light shafts and fill the lights uniform buffer with the rest.
+	* @param camera - currently using camera
+	* @param lights	- all point lights making light shafts
+	* @returns intensity of light shafts of the brightest light (0 when all lights are culled)
+	*/
+	GLfloat UpdateLightsBuffer(Camera * camera, const std::vector<Light*> &lights);
+
+	/**
+	* Go to the next number of lights of the sweep when the current one was calculated long enough.
+	* @param count - number of all lights
+	*/
+	void UpdateLightsSweep(int count);
+
+	/**
+	* Calculate the light scattering of all lights from the lights uniform buffer in one pass.
+	* The result is left in the scatter texture of scatterResult index.
+	* @param camera - currently using camera
+	*/
+	void DrawMultiLightScattering(Camera * camera);
+
+	/**
+	* Calculate light shafts along the epipolar lines and store them in the epipolar texture.
+	* @param camera					- currently using camera
+	* @param lightScreenPosition	- position of the light source on screen in (0,1) coordinates
+	*/
+	void DrawEpipolarLines(Camera * camera, const glm::vec2 &lightScreenPosition);
+
+	/**
+	* Set the uniforms describing epipolar lines for the given program.
+	* Rows of the polar texture are going in the same directions, so polar shaders use them too.
+	* @param program				- Handler of the program using the uniforms
+	* @param camera					- currently using camera
+	* @param lightScreenPosition	- position of the light source on screen in (0,1) coordinates
+	*/
+	void SetEpipolarUniforms(GLuint program, Camera * camera, const glm::vec2 &lightScreenPosition);
+
+	/**
+	* Calculate the light scattering in lower resolution (or in low quality) and store it in the scatter texture.
+	* @param camera					- currently using camera
+	* @param lightScreenPosition	- position of the light source on screen in (0,1) coordinates
+	*/
+	void DrawScattering(Camera * camera, const glm::vec2 &lightScreenPosition);
+
+	/**
+	* Blur the light scattering horizontally and then vertically, without blurring through silhouettes.
+	* The result is left in the scatter texture of scatterResult index.
+	*/
+	void DrawDenoise();
+
+	/**
+	* Calculate the light scattering with few passes of short radial blur, ping-ponging
+	* between scatter textures. The result is left in the scatter texture of scatterResult index.
+	* @param camera					- currently using camera
+	* @param lightScreenPosition	- position of the light source on screen in (0,1) coordinates
+	*/
+	void DrawHierarchicalScattering(Camera * camera, const glm::vec2 &lightScreenPosition);
+
+	/**
+	* Calculate the light scattering by warping the occlusion into polar coordinates around the light,
+	* scanning every direction with a recursive filter in compute shader and warping it back.
+	* The result is left in the scatter texture of scatterResult index.
+	* @param camera					- currently using camera
+	* @param lightScreenPosition	- position of the light source on screen in (0,1) coordinates
+	*/
+	void DrawPolarScattering(Camera * camera, const glm::vec2 &lightScreenPosition);
+
+	/**
+	* Calculate the light scattering in compute shader, tile by tile, and store it in the scatter texture.
+	* @param camera					- currently using camera
+	* @param lightScreenPosition	- position of the light source on screen in (0,1) coordinates
+	*/
+	void DrawComputeScattering(Camera * camera, const glm::vec2 &lightScreenPosition);
+
+	/**
+	* Calculate a part of light scattering taps and accumulate them with the reprojected history
+	* of previous frames. The result is left in the scatter texture of scatterResult index.
+	* @param camera					- currently using camera
+	* @param lightScreenPosition	- position of the light source on screen in (0,1) coordinates
+	*/
+	void DrawTemporalScattering(Camera * camera, const glm::vec2 &lightScreenPosition);
+
+	/**
+	* Pack the occlusion into the bit mask in compute shader.
+	*/
+	void DrawOcclusionBitmask();
+
+	/**
+	* Build the min/max pyramid of the occlusion, level by level.
+	*/
+	void DrawMinMaxPyramid();
+
+	/**
+	* Draw light shafts with skipping once more, only to count pixels where they differ from the brute force loop.
+	* The count is added to profiler counters.
+	*/
+	void ValidateSkipping();
+
+	/**
+	* Draw adaptive light shafts once more, only to count the average number of taps they take.
+	* The count is added to profiler counters.
+	*/
+	void CountAdaptiveTaps();
+
+	/**
+	* Draw cone light shafts and the radial blur once more, one after another into the same target,
+	* only to measure how much time cone taps save. Results are read a few frames late without waiting
+	* and added to profiler counters.
+	* @param lightScreenPosition	- position of the light source on screen in (0,1) coordinates
+	* @param intensity				- intensity of light shafts
+	*/
+	void MeasureConeSaving(const glm::vec2 &lightScreenPosition, GLfloat intensity);
+
+	/**
+	* Draw light markers into the currently bound occlusion, counting how much of the single marker is visible.
+	* @param lights	- all point lights making light shafts
+	*/
+	void DrawMarkers(const std::vector<Light*> &lights);
+
+	/**
+	* Copy the final scene from the resolve texture to the screen, dithering and upscaling it when needed.
+	*/
+	void DrawResolve();
+
+	/**
+	* Classify tiles of the screen into tiles that can have light shafts and tiles that can't,
+	* filling the indirect draw commands and lists of both of them.
+	* @param camera					- currently using camera
+	* @param lightScreenPosition	- position of the light source on screen in (0,1) coordinates
+	*/
+	void ClassifyTiles(Camera * camera, const glm::vec2 &lightScreenPosition);
+
+	/**
+	* Draw the quad on every tile of the list with currently used program.
+	* @param program	- Handler of the currently used program
+	* @param list		- Index of the list of tiles (0 - tiles with light shafts, 1 - tiles without them)
+	*/
+	void DrawTiles(GLuint program, int list);
+
 	GLuint shader;								///< Handler of the shader that draws final scene	
 	GLuint vertex_loc;							///< Vertex pointer needed for shader
 	GLuint texcoord_loc;						///< Texture coordinates pointer needed for shader
 
-	GLuint renderTextureArrayColor;				///< Textures array for color handler
-	GLuint renderTextureArrayDepth;				///< Textures array for depth handler
-	GLuint frameBuffers[2];						///< Frame buffers for rendering to textures
+	GLuint renderTextureArrayColor;				///< Textures array for color of the normal scene
+	GLuint renderTextureArrayDepth;				///< Textures array for depth of the normal scene
+	GLuint normalFrameBuffer;					///< Frame buffer for reading the normal scene
+
+	GLuint occlusionTexture;					///< Single channel texture with the occlusion (how much light passes)
+	GLuint depthOcclusionShader;				///< Handler of the shader that makes the occlusion from the depth
+	int occlusionWidth;							///< Width of the occlusion texture
+	int occlusionHeight;						///< Height of the occlusion texture
+	int occlusionMipLevels;						///< Number of mip levels of the occlusion texture
+	glm::vec3 lightColor;						///< Color of the light the occlusion is tinted with (white with many lights)
+
+	GLuint epipolarShader;						///< Handler of the shader that calculates light shafts along epipolar lines
+	GLuint epipolarCompositeShader;				///< Handler of the shader that draws final scene from epipolar lines
+	GLuint epipolarTexture;						///< Texture with light shafts calculated along epipolar lines
+	GLuint epipolarFrameBuffer;					///< Frame buffer for rendering to the epipolar texture
+
+	GLuint upsampleShader;						///< Handler of the shader that draws final scene with upsampled light scattering
+	GLuint hierarchicalShader;					///< Handler of the shader that calculates one pass of hierarchical radial blur
+	GLuint scatterTextures[2];					///< Textures with light scattering in lower resolution (two for ping-pong)
+	GLuint scatterFrameBuffers[2];				///< Frame buffers for rendering to the scatter textures
+	int scatterResult;							///< Index of the scatter texture with the final light scattering
+	int scatterWidth;							///< Width of the scatter texture
+	int scatterHeight;							///< Height of the scatter texture
+
+	GLuint polarWarpShader;						///< Handler of the shader that warps the occlusion into polar coordinates
+	GLuint polarScanShader;						///< Handler of the compute shader that calculates light scattering along polar rows
+	GLuint polarUnwarpShader;					///< Handler of the shader that warps the light scattering back to the screen
+	GLuint polarTextures[2];					///< Textures in polar coordinates: 0 - occlusion, 1 - light scattering
+	GLuint polarFrameBuffer;					///< Frame buffer for rendering to the polar occlusion texture
+
+	GLuint computeShader;						///< Handler of the compute shader that calculates light scattering tile by tile
+
+	GLuint denoiseShader;						///< Handler of the shader that blurs the light scattering in one direction
+	GLuint noiseTexture;						///< Texture with tiled blue noise
+
+	GLuint temporalShader;						///< Handler of the shader that accumulates light scattering over frames
+	GLuint temporalAgeTextures[2];				///< Number of frames accumulated in each of the scatter textures
+	GLuint temporalFrameBuffers[2];				///< Frame buffers for rendering to scatter and age textures together
+	int temporalFrame;							///< Number of frames rendered in temporal mode
+	glm::mat4 previousViewProjection;			///< View projection matrix of the camera in the previous frame
+	glm::vec2 previousLightScreenPosition;		///< Position of the light source on screen in the previous frame
+
+	GLuint coneQueries[SHAFTS_CONE_QUERIES][3];	///< Timestamps before the cone taps, between them and the radial blur and after it
+	bool coneQueryIssued[SHAFTS_CONE_QUERIES];	///< True when the timestamps of this index wait for results
+	int coneQueryNext;							///< Index of the timestamps used next time
+	GLuint markerQueries[2][2];					///< Samples queries of the light marker for two frames: 0 - visible samples, 1 - all samples
+	int markerQueryFrame;						///< Index of the queries used in the current frame
+	bool markerQueryIssued[2];					///< True when the queries of this index were used
+	GLfloat markerVisibility;					///< Visible part of the light marker in the previous frame
+
+	GLuint multiLightShader;					///< Handler of the shader that calculates light scattering of many lights
+	GLuint lightsUBO;							///< Uniform buffer object with screen positions and colors of lights
+	int lightsCount;							///< Number of lights in the lights uniform buffer
+	int lightsSamples;							///< Number of samples of every light in the lights uniform buffer
+	bool lightsSweep;							///< True when the number of calculated lights goes through 1, 4, 16 and 64 (with the profiler)
+	int lightsLimit;							///< The most lights calculated now
+	int sweepInterval;							///< Number of frames every number of lights is calculated for in the sweep
+	int sweepFrame;								///< Number of frames the current number of lights was calculated for
+
+	GLuint coneShader;							///< Handler of the shader that draws final scene with taps reading the occlusion mipmaps
+
+	GLuint bitmaskShader;						///< Handler of the compute shader that packs the occlusion into bits
+	GLuint bitmaskCompositeShader;				///< Handler of the shader that draws final scene from the occlusion bit mask
+	GLuint bitmaskTexture;						///< Occlusion packed into bits, 32 horizontal texels in every texel
+	int bitmaskWidth;							///< Width of the bit mask texture
+
+	GLuint minMaxShader;						///< Handler of the shader that builds one level of the min/max pyramid
+	GLuint skipShader;							///< Handler of the shader that draws final scene skipping uniform occlusion
+	GLuint minMaxTexture;						///< Min/max pyramid of the occlusion (r - minimum, g - maximum)
+	GLuint minMaxFrameBuffer;					///< Frame buffer for rendering to levels of the min/max pyramid
+	int minMaxLevels;							///< Number of levels of the min/max pyramid
+	GLuint skipValidateQuery;					///< Samples query counting pixels that differ from the brute force loop
+
+	const ShaftsFormat *colorTargetFormat;		///< Format of the normal scene color
+	const ShaftsFormat *occlusionTargetFormat;	///< Format of the occlusion
+	const ShaftsFormat *depthTargetFormat;		///< Format of the normal scene and the occlusion depth
+	GLfloat targetsMegabytes;					///< Memory taken by render targets of the scene, the occlusion, the resolve and transients
+
+	GLuint resolveShader;						///< Handler of the shader that copies the final scene to the screen
+	GLuint resolveTexture;						///< Final scene in higher precision than the screen
+	GLuint resolveFrameBuffer;					///< Frame buffer for rendering the final scene to the resolve texture
+	bool useResolve;							///< True when the final scene goes through the resolve texture
+
+	std::map<std::string, GLuint> programVariants;	///< Specialized programs keyed by the fragment shader path and its defines
+	GLuint radialShader;						///< Handler of the shader that draws final scene, specialized for the quality tier
+	GLuint radialScatterShader;					///< Handler of the shader that calculates the light scattering, specialized for the quality tier
+
+	GLuint adaptiveShader;						///< Handler of the shader that draws final scene with the adaptive number of taps
+
+	GLuint tileReduceShader;					///< Handler of the compute shader that finds the brightest occlusion of every tile
+	GLuint tileClassifyShader;					///< Handler of the compute shader that sorts tiles into lists
+	GLuint tileShader;							///< Handler of the shader that draws final scene with light shafts on listed tiles
+	GLuint tileCopyShader;						///< Handler of the shader that draws final scene without light shafts on listed tiles
+	GLuint tileTexture;							///< Texture with the brightest occlusion of every tile
+	GLuint tileCommandsBuffer;					///< Buffer with indirect draw commands of both lists of tiles
+	GLuint tileListsBuffer;						///< Buffer with lists of tiles
+	int tilesX;									///< Number of tile columns on the screen
+	int tilesY;									///< Number of tile rows on the screen
+	glm::vec2 tileScale;						///< Size of one tile in texture coordinates
 
 	GLuint VAO;									///< Vertex array object for shader that renders final scene
 	GLuint VBO[2];								///< Vertex buffer object for shader that renders final scene 
@@ -22,10 +22,13 @@ int main()
 		ENGINE->Poll();
 	}
 
+	// Remember if any check failed before the engine is gone
+	int exitCode = ENGINE->GetExitCode();
+
 	// When engine has been stopped clear the memory
 	ENGINE_CLEAN
 
-	// Exit application with no errors
-	exit(EXIT_SUCCESS);
+	// Exit application with no errors (or with the failure of a check)
+	exit(exitCode);
 	return 0;
 }
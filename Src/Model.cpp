@@ -8,6 +8,7 @@
 
 #include "Model.h"
 #include "Shaders.h"
+#include "GLState.h"
 #include "Engine.h"
 #include "Scene.h"
 #include "Window.h"
@@ -50,12 +51,25 @@ Model::Model()
 	/// Create a shader for rendering this model
 	Shaders::AttachShader(shader, GL_VERTEX_SHADER, "data/shaders/model_render_vs.glsl");
 	Shaders::AttachShader(shader, GL_FRAGMENT_SHADER, "data/shaders/model_render_fs.glsl");
+
+	// The color goes to the first attachment and the occlusion (used only in the single pass) to the second one.
+	glBindFragDataLocation(shader, 0, "outColor");
+	glBindFragDataLocation(shader, 1, "outOcclusion");
 	Shaders::LinkProgram(shader);
 
 	/// Remember locations of vertex positions, normals and shading parameters structure from shader.
 	/// The shading parameters are where material and light parameters are stored.
 	vertex_loc = glGetAttribLocation(shader, "inPosition");
 	normal_loc = glGetAttribLocation(shader, "inNormal");
+
+	/// Create a shader for drawing only the depth. It reads positions from the same location,
+	/// so the same vertex array object can be used.
+	depthShader = 0;
+	Shaders::AttachShader(depthShader, GL_VERTEX_SHADER, "data/shaders/model_depth_vs.glsl");
+	Shaders::AttachShader(depthShader, GL_FRAGMENT_SHADER, "data/shaders/model_depth_fs.glsl");
+	glBindAttribLocation(depthShader, vertex_loc, "inPosition");
+	Shaders::LinkProgram(depthShader);
+
 	GLuint shadingParamsIndex = glGetUniformBlockIndex(shader, "Shading");
 
 	/// Generate all necessary buffors for shader
@@ -65,34 +79,34 @@ Model::Model()
 
 
 	/// Fill the element array buffer with teapot indicies
-	glBindVertexArray(VAO);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, VBO[0]);
+	GLState::BindVertexArray(VAO);
+	GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, VBO[0]);
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(teapotHighIndices), teapotHighIndices, GL_STATIC_DRAW);
 
 	/// Fill the buffer with teapot vertices
-	glBindBuffer(GL_ARRAY_BUFFER, VBO[1]);
+	GLState::BindBuffer(GL_ARRAY_BUFFER, VBO[1]);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(teapotHighPosition), teapotHighPosition, GL_STATIC_DRAW);
 		glVertexAttribPointer(vertex_loc, 3, GL_FLOAT, GL_FALSE, 0, NULL);
 		glEnableVertexAttribArray(vertex_loc);
 
 	/// Fill the buffer with teapot normals
-	glBindBuffer(GL_ARRAY_BUFFER, VBO[2]);
+	GLState::BindBuffer(GL_ARRAY_BUFFER, VBO[2]);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(teapotHighNormal), teapotHighNormal, GL_STATIC_DRAW);
 		glVertexAttribPointer(normal_loc, 3, GL_FLOAT, GL_FALSE, 0, NULL);
 		glEnableVertexAttribArray(normal_loc);
 
-	glBindVertexArray(0);
+	GLState::BindVertexArray(0);
 
 	/// Declare the space in uniform buffer for shader where light and material parameters will be stored
 	/// Remember all parameters offsets so the uniform buffer can be easely fill after that.
-	glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+	GLState::BindBuffer(GL_UNIFORM_BUFFER, UBO);
 
 	// Get the needed size of uniform buffer (the size of data structure in shader)
 	GLint shadingParamsSize;
 	glGetActiveUniformBlockiv(shader, shadingParamsIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &shadingParamsSize);
 	glBufferData(GL_UNIFORM_BUFFER, shadingParamsSize, NULL, GL_DYNAMIC_DRAW);
 
-	glBindBufferBase(GL_UNIFORM_BUFFER, 0, UBO);
+	GLState::BindBufferBase(GL_UNIFORM_BUFFER, 0, UBO);
 	glUniformBlockBinding(shader, shadingParamsIndex, 0);	
 
 	// Prepare the array for parameters indices and helper array with parameters names
@@ -130,8 +144,8 @@ Model::Model()
 	glBufferSubData(GL_UNIFORM_BUFFER, uniformsOffset[8], 12, glm::value_ptr(light->attenuation));
 
 	// Unbind the buffer object so program won't use them unnecessarily
-	glBindBufferBase(GL_UNIFORM_BUFFER, 0, 0);
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	GLState::BindBufferBase(GL_UNIFORM_BUFFER, 0, 0);
+	GLState::BindBuffer(GL_UNIFORM_BUFFER, 0);
 }
 
 /**
@@ -141,11 +155,10 @@ Model::Model()
 void Model::UpdateBuffer(Light * light)
 {
 	/// Bind the object buffer and update the light diffuse color parameter so it
-	/// will have color like in tweak bar. After that unbind buffer object so program won't 
-	/// use them unnecessarily.
-	glBindBufferBase(GL_UNIFORM_BUFFER, 0, UBO);
+	/// will have color like in tweak bar. It stays bound, so drawing the model doesn't bind it again
+	/// (every draw binds what it needs and the state cache skips what is already bound).
+	GLState::BindBufferBase(GL_UNIFORM_BUFFER, 0, UBO);
 		glBufferSubData(GL_UNIFORM_BUFFER, uniformsOffset[6], 16, light->diffuse);
-	glBindBufferBase(GL_UNIFORM_BUFFER, 0, 0);
 }
 
 /**
@@ -166,7 +179,8 @@ void Model::Draw(Camera * camera, Light * light, bool occlusion)
 
 	/// Draw the model using all calculated parameters, buffers and flag deciding if this render pass is occlusion only.
 	/// Remember to use glDrawElements method, because we are using indicies in elements array.
-	glUseProgram(shader);
+	/// The program and buffers stay bound after drawing, so the next draw with them doesn't bind them again.
+	GLState::UseProgram(shader);
 
 		glUniformMatrix4fv(glGetUniformLocation(shader, "modelViewProjectionMatrix"), 1, GL_FALSE, glm::value_ptr(modelViewProjectionMatrix));
 		glUniform1i(glGetUniformLocation(shader, "occlusion"), occlusion);
@@ -188,13 +202,31 @@ void Model::Draw(Camera * camera, Light * light, bool occlusion)
 			glUniform4fv(glGetUniformLocation(shader, "eyePosition"), 1, glm::value_ptr(eyePosition));
 		}
 
-		glBindVertexArray(VAO);
-			glBindBufferBase(GL_UNIFORM_BUFFER, 0, UBO);
+		GLState::BindVertexArray(VAO);
+			GLState::BindBufferBase(GL_UNIFORM_BUFFER, 0, UBO);
+			glDrawElements(GL_TRIANGLES, teapotHighIndicesCount * 3, GL_UNSIGNED_INT, NULL);
+}
+
+/**
+* Draw only the depth of the model (for the depth pre-pass).
+* @param camera		- currently used for rendering camera
+*/
+void Model::DrawDepth(Camera * camera)
+{
+	// The same matrix as in the shaded pass, so depths are the same.
+	glm::mat4 modelMatrix = glm::mat4() * glm::translate(glm::mat4(), position);
+	glm::mat4 modelViewProjectionMatrix = camera->GetViewProjectionMatrix() * modelMatrix;
+
+	// Only the depth is written.
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	GLState::UseProgram(depthShader);
+
+		glUniformMatrix4fv(glGetUniformLocation(depthShader, "modelViewProjectionMatrix"), 1, GL_FALSE, glm::value_ptr(modelViewProjectionMatrix));
+
+		GLState::BindVertexArray(VAO);
 			glDrawElements(GL_TRIANGLES, teapotHighIndicesCount * 3, GL_UNSIGNED_INT, NULL);
-			glBindBufferBase(GL_UNIFORM_BUFFER, 0, 0);
-		glBindVertexArray(0);
 
-	glUseProgram(0);
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
 }
 
 /**
@@ -204,7 +236,9 @@ Model::~Model()
 {
 	Shaders::DeleteShaders(shader);
 	glDeleteProgram(shader);
-	glDeleteBuffers(3, VBO);
-	glDeleteBuffers(1, &UBO);
-	glDeleteVertexArrays(1, &VAO);
+	Shaders::DeleteShaders(depthShader);
+	glDeleteProgram(depthShader);
+	GLState::DeleteBuffers(3, VBO);
+	GLState::DeleteBuffers(1, &UBO);
+	GLState::DeleteVertexArrays(1, &VAO);
 }
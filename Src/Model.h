@@ -53,8 +53,15 @@ public:
 	*/
 	void Draw(Camera * camera, Light * light, bool occlusion);
 
+	/**
+	* Draw only the depth of the model (for the depth pre-pass).
+	* @param camera		- currently used for rendering camera
+	*/
+	void DrawDepth(Camera * camera);
+
 private:
 	GLuint shader;		///< Handler of the shader that draws the model	
+	GLuint depthShader;	///< Handler of the shader that draws only the depth of the model
 
 	GLuint VAO;			///< Vertex array object for shader that renders the model
 	GLuint VBO[3];		///< Vertex byffer object for shader that renders the model
@@ -0,0 +1,349 @@
+/**
+* LightShafts example.
+*
+* This is a profiler class. It measures how long the GPU takes for
+* named sections of the frame and averages them with other per frame
+* values (counters) and GPU statistics (like the number of shaded fragments),
+* printing all of them every few frames.
+*
+* (c) 2014 Damian Nowakowski
+*/
+
+#include "Profiler.h"
+
+/**
+* Simple constructor with initialization
+*/
+Profiler::Profiler()
+{
+	// Remember the configuration reader so we can use it in the future.
+	INIReader * localINIReader = ENGINE->config;
+
+	enabled		= localINIReader->GetBoolean("Benchmark", "Profile", false);
+	interval	= localINIReader->GetInteger("Benchmark", "ProfileInterval", 120);
+	if (interval < 1)
+	{
+		interval = 1;
+	}
+
+	currentSection	= -1;
+	currentStatistic = -1;
+	frame			= 0;
+	frameStartTime	= glfwGetTime();
+	frameNumber		= 0;
+	takenFrame		= 0;
+	for (int i = 0; i < PROFILER_FRAMES; i++)
+	{
+		frameTimes[i].number = -1;
+	}
+	frameTimes[0].number	= 0;
+	frameTimes[0].time		= 0;
+	frameTimes[0].measured	= 0;
+	frameTimes[0].pending	= 0;
+	frameTimes[0].ended		= false;
+}
+
+/**
+* Start measuring the GPU time of the section. Sections can't be nested.
+* @param name - Name of the section
+*/
+void Profiler::BeginSection(const char *name)
+{
+	if (enabled == false)
+	{
+		return;
+	}
+
+	currentSection = BeginQuery(name, GL_TIME_ELAPSED);
+}
+
+/**
+* Stop measuring the GPU time of the section started last.
+*/
+void Profiler::EndSection()
+{
+	if (enabled == false || currentSection < 0)
+	{
+		return;
+	}
+
+	EndQuery(currentSection);
+	currentSection = -1;
+}
+
+/**
+* Start counting the GPU statistic (e.g. GL_SAMPLES_PASSED). Statistics can't be nested,
+* but they can be counted inside of a section.
+* @param name	- Name of the statistic
+* @param target	- Target of the query counting the statistic
+*/
+void Profiler::BeginStatistic(const char *name, GLenum target)
+{
+	if (enabled == false)
+	{
+		return;
+	}
+
+	currentStatistic = BeginQuery(name, target);
+}
+
+/**
+* Stop counting the GPU statistic started last.
+*/
+void Profiler::EndStatistic()
+{
+	if (enabled == false || currentStatistic < 0)
+	{
+		return;
+	}
+
+	EndQuery(currentStatistic);
+	currentStatistic = -1;
+}
+
+/**
+* Add the value of the counter in this frame. Counters are averaged over printed frames.
+* @param name	- Name of the counter
+* @param value	- Value of the counter in this frame
+*/
+void Profiler::AddCounter(const char *name, double value)
+{
+	if (enabled == false)
+	{
+		return;
+	}
+
+	for (int i = 0; i < (int)counters.size(); i++)
+	{
+		if (counters[i].name == name)
+		{
+			counters[i].sum += value;
+			counters[i].count++;
+			return;
+		}
+	}
+
+	Counter counter;
+	counter.name = name;
+	counter.sum = value;
+	counter.count = 1;
+	counters.push_back(counter);
+}
+
+/**
+* Run this after the frame is drawn. It collects finished measurements
+* and prints the statistics when enough frames passed.
+*/
+void Profiler::EndFrame()
+{
+	if (enabled == false)
+	{
+		return;
+	}
+
+	// The frame is drawn, so its time is known when all its sections are measured.
+	frameTimes[frameNumber % PROFILER_FRAMES].ended = true;
+
+	/// Start summing the next frame. The oldest frame kept is overwritten, when it still waits
+	/// for its sections or was not taken it is dropped.
+	frameNumber++;
+	FrameTime &frameTime = frameTimes[frameNumber % PROFILER_FRAMES];
+	frameTime.number	= frameNumber;
+	frameTime.time		= 0;
+	frameTime.measured	= 0;
+	frameTime.pending	= 0;
+	frameTime.ended		= false;
+
+	// Collect the results that are already available, without waiting for the rest.
+	for (int i = 0; i < (int)sections.size(); i++)
+	{
+		for (int j = 0; j < PROFILER_QUERIES; j++)
+		{
+			if (sections[i].issued[j] == false)
+			{
+				continue;
+			}
+			GLuint available = 0;
+			glGetQueryObjectuiv(sections[i].queries[j], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (available != 0)
+			{
+				ReadQuery(sections[i], j);
+			}
+		}
+	}
+
+	frame++;
+	if (frame < interval)
+	{
+		return;
+	}
+
+	/// Print the average of every section and counter over the passed frames and start counting again.
+	double time = glfwGetTime();
+	printf("Frame %.2f ms", (time - frameStartTime) * 1000.0 / frame);
+	for (int i = 0; i < (int)sections.size(); i++)
+	{
+		double average = (sections[i].count > 0) ? sections[i].time / sections[i].count : 0.0;
+		if (sections[i].target == GL_TIME_ELAPSED)
+		{
+			printf(", %s %.3f ms", sections[i].name.c_str(), average);
+		}
+		else
+		{
+			printf(", %s %.0f", sections[i].name.c_str(), average);
+		}
+		sections[i].time = 0;
+		sections[i].count = 0;
+	}
+	for (int i = 0; i < (int)counters.size(); i++)
+	{
+		// Skip counters that were not added in these frames.
+		if (counters[i].count == 0)
+		{
+			continue;
+		}
+		printf(", %s %.2f", counters[i].name.c_str(), counters[i].sum / counters[i].count);
+		counters[i].sum = 0;
+		counters[i].count = 0;
+	}
+	printf("\n");
+
+	frame = 0;
+	frameStartTime = time;
+}
+
+/**
+* Get the number of the frame being drawn now. Frames are counted from 0 and never reset.
+* @returns the number of the current frame
+*/
+int Profiler::GetFrameNumber()
+{
+	return frameNumber;
+}
+
+/**
+* Take the GPU time of the oldest frame whose sections are all measured and that was not taken yet.
+* It is the sum of times of its sections, so time between them (when the GPU waits for the CPU)
+* is not counted. Frames that waited too long are dropped.
+* @param number	- returns the number of the frame
+* @param time	- returns the sum of times of its sections in milliseconds
+* @returns true when there was such a frame
+*/
+bool Profiler::TakeFrameTime(int &number, double &time)
+{
+	// Frames are taken in order, the oldest one still waiting for its sections stops taking them.
+	for (; takenFrame < frameNumber; takenFrame++)
+	{
+		FrameTime &frameTime = frameTimes[takenFrame % PROFILER_FRAMES];
+		// Dropped frames and frames without sections are passed over.
+		if (frameTime.number != takenFrame || (frameTime.ended && frameTime.measured == 0))
+		{
+			continue;
+		}
+		if (frameTime.ended == false || frameTime.pending > 0)
+		{
+			return false;
+		}
+		number = takenFrame;
+		time = frameTime.time;
+		takenFrame++;
+		return true;
+	}
+	return false;
+}
+
+/**
+* Find the section (or statistic) or make a new one and begin its next query.
+* @param name	- Name of the section
+* @param target	- Target of the query
+* @return Index of the section
+*/
+int Profiler::BeginQuery(const char *name, GLenum target)
+{
+	// Find the section or make a new one when it is measured for the first time.
+	int index = -1;
+	for (int i = 0; i < (int)sections.size(); i++)
+	{
+		if (sections[i].name == name && sections[i].target == target)
+		{
+			index = i;
+			break;
+		}
+	}
+	if (index < 0)
+	{
+		Section section;
+		section.name = name;
+		section.target = target;
+		glGenQueries(PROFILER_QUERIES, section.queries);
+		for (int i = 0; i < PROFILER_QUERIES; i++)
+		{
+			section.issued[i] = false;
+		}
+		section.next = 0;
+		section.time = 0;
+		section.count = 0;
+		sections.push_back(section);
+		index = (int)sections.size() - 1;
+	}
+
+	// When all queries are still waiting the oldest one has to be read (this waits for the GPU).
+	Section &section = sections[index];
+	if (section.issued[section.next] == true)
+	{
+		ReadQuery(section, section.next);
+	}
+	glBeginQuery(target, section.queries[section.next]);
+	return index;
+}
+
+/**
+* End the query of the section begun last.
+* @param index - Index of the section
+*/
+void Profiler::EndQuery(int index)
+{
+	Section &section = sections[index];
+	glEndQuery(section.target);
+	section.issued[section.next] = true;
+	section.frames[section.next] = frameNumber;
+	if (section.target == GL_TIME_ELAPSED)
+	{
+		frameTimes[frameNumber % PROFILER_FRAMES].measured++;
+		frameTimes[frameNumber % PROFILER_FRAMES].pending++;
+	}
+	section.next = (section.next + 1) % PROFILER_QUERIES;
+}
+
+/**
+* Read the result of the query of the section and add it to the section time.
+* @param section	- Section owning the query
+* @param index		- Index of the query in the section
+*/
+void Profiler::ReadQuery(Section &section, int index)
+{
+	GLuint64 elapsed = 0;
+	glGetQueryObjectui64v(section.queries[index], GL_QUERY_RESULT, &elapsed);
+	section.time += (section.target == GL_TIME_ELAPSED) ? elapsed / 1000000.0 : (double)elapsed;
+	section.count++;
+	section.issued[index] = false;
+
+	// Add the time to its frame, unless the frame was already dropped.
+	FrameTime &frameTime = frameTimes[section.frames[index] % PROFILER_FRAMES];
+	if (section.target == GL_TIME_ELAPSED && frameTime.number == section.frames[index])
+	{
+		frameTime.time += elapsed / 1000000.0;
+		frameTime.pending--;
+	}
+}
+
+/**
+* Simple destructor clearing all data.
+*/
+Profiler::~Profiler()
+{
+	for (int i = 0; i < (int)sections.size(); i++)
+	{
+		glDeleteQueries(PROFILER_QUERIES, sections[i].queries);
+	}
+}
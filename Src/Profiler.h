@@ -0,0 +1,158 @@
+#pragma once
+
+/**
+* LightShafts example.
+*
+* This is a profiler class. It measures how long the GPU takes for
+* named sections of the frame and averages them with other per frame
+* values (counters) and GPU statistics (like the number of shaded fragments),
+* printing all of them every few frames.
+*
+* (c) 2014 Damian Nowakowski
+*/
+
+#include <string>
+#include <vector>
+#include "Engine.h"
+
+// Define the number of queries every section cycles through, so results are read a few frames late without waiting
+#define PROFILER_QUERIES 4
+
+// Define the number of frames whose summed section times are kept until they are taken
+#define PROFILER_FRAMES 8
+
+class Profiler
+{
+public:
+	/**
+	* Simple constructor and destructor
+	*/
+	Profiler();
+	~Profiler();
+
+	bool enabled;	///< True when sections are measured and statistics are printed
+
+	/**
+	* Start measuring the GPU time of the section. Sections can't be nested.
+	* @param name - Name of the section
+	*/
+	void BeginSection(const char *name);
+
+	/**
+	* Stop measuring the GPU time of the section started last.
+	*/
+	void EndSection();
+
+	/**
+	* Start counting the GPU statistic (e.g. GL_SAMPLES_PASSED). Statistics can't be nested,
+	* but they can be counted inside of a section.
+	* @param name	- Name of the statistic
+	* @param target	- Target of the query counting the statistic
+	*/
+	void BeginStatistic(const char *name, GLenum target);
+
+	/**
+	* Stop counting the GPU statistic started last.
+	*/
+	void EndStatistic();
+
+	/**
+	* Add the value of the counter in this frame. Counters are averaged over printed frames.
+	* @param name	- Name of the counter
+	* @param value	- Value of the counter in this frame
+	*/
+	void AddCounter(const char *name, double value);
+
+	/**
+	* Run this after the frame is drawn. It collects finished measurements
+	* and prints the statistics when enough frames passed.
+	*/
+	void EndFrame();
+
+	/**
+	* Get the number of the frame being drawn now. Frames are counted from 0 and never reset.
+	* @returns the number of the current frame
+	*/
+	int GetFrameNumber();
+
+	/**
+	* Take the GPU time of the oldest frame whose sections are all measured and that was not taken yet.
+	* It is the sum of times of its sections, so time between them (when the GPU waits for the CPU)
+	* is not counted. Frames that waited too long are dropped.
+	* @param number	- returns the number of the frame
+	* @param time	- returns the sum of times of its sections in milliseconds
+	* @returns true when there was such a frame
+	*/
+	bool TakeFrameTime(int &number, double &time);
+
+private:
+
+	/**
+	* Named section of the frame (or statistic) with its own ring of queries.
+	*/
+	struct Section
+	{
+		std::string name;					///< Name of the section
+		GLenum target;						///< Target of queries (GL_TIME_ELAPSED for sections)
+		GLuint queries[PROFILER_QUERIES];	///< Queries used one after another
+		bool issued[PROFILER_QUERIES];		///< True when the query waits for its result
+		int frames[PROFILER_QUERIES];		///< Number of the frame every query was used in
+		int next;							///< Index of the query used next time
+		double time;						///< Sum of measured times in milliseconds (or statistic values)
+		int count;							///< Number of measured times
+	};
+
+	/**
+	* Named value averaged over frames.
+	*/
+	struct Counter
+	{
+		std::string name;	///< Name of the counter
+		double sum;			///< Sum of values
+		int count;			///< Number of values
+	};
+
+	/**
+	* Sum of times of sections of one frame.
+	*/
+	struct FrameTime
+	{
+		int number;		///< Number of the frame
+		double time;	///< Sum of measured times of its sections in milliseconds
+		int measured;	///< Number of its measured sections
+		int pending;	///< Number of its sections still waiting for results
+		bool ended;		///< True when the frame was drawn to the end
+	};
+
+	/**
+	* Find the section (or statistic) or make a new one and begin its next query.
+	* @param name	- Name of the section
+	* @param target	- Target of the query
+	* @return Index of the section
+	*/
+	int BeginQuery(const char *name, GLenum target);
+
+	/**
+	* End the query of the section begun last.
+	* @param index - Index of the section
+	*/
+	void EndQuery(int index);
+
+	/**
+	* Read the result of the query of the section and add it to the section time.
+	* @param section	- Section owning the query
+	* @param index		- Index of the query in the section
+	*/
+	void ReadQuery(Section &section, int index);
+
+	std::vector<Section> sections;	///< All sections measured so far
+	std::vector<Counter> counters;	///< All counters added so far
+	int currentSection;				///< Index of the measured section (-1 when none)
+	int currentStatistic;			///< Index of the counted statistic (-1 when none)
+	int interval;					///< Number of frames between printing the statistics
+	int frame;						///< Number of frames since the statistics were printed
+	double frameStartTime;			///< Time when the statistics were printed last
+	int frameNumber;				///< Number of the frame being drawn
+	int takenFrame;					///< Number of the next frame whose time is taken
+	FrameTime frameTimes[PROFILER_FRAMES];	///< Sums of times of sections of the last frames
+};
@@ -0,0 +1,260 @@
+/**
+* LightShafts example.
+*
+* This is a render target pool class. Textures of render targets are taken
+* from it and given back to it, and it keeps a few of the given back ones
+* for a while, so targets made again with the same size and format (when
+* the window is resized back and forth or the render scale goes up and down)
+* don't have to be created by the driver again.
+*
+* (c) 2014 Damian Nowakowski
+*/
+
+#include "RenderTargetPool.h"
+#include "Profiler.h"
+#include "GLState.h"
+#include "glm/glm.hpp"
+
+/**
+* Simple constructor with initialization
+*/
+RenderTargetPool::RenderTargetPool()
+{
+	cacheSize = glm::max(0, (int)ENGINE->config->GetInteger("Render", "TargetCacheSize", 8));
+
+	allocations = reuses = evictions = 0;
+	printedAllocations = printedReuses = printedEvictions = 0;
+}
+
+/**
+* Take the texture with the description. The most recently given back one with the same
+* description is taken when there is any, otherwise a new one is created.
+* @param desc - Description of the texture
+* @return Handler of the texture
+*/
+GLuint RenderTargetPool::Acquire(const FrameGraphTextureDesc &desc)
+{
+	Target target;
+	target.desc = desc;
+	target.texture = 0;
+
+	/// Kept textures are searched from the most recently given back one, which is the one most likely
+	/// to be needed again (the window dragged back to the previous size). Its sampling parameters could
+	/// have been changed by the previous user, so they are set again.
+	for (int i = (int)cached.size() - 1; i >= 0; i--)
+	{
+		if (SameTexture(cached[i].desc, desc))
+		{
+			target.texture = cached[i].texture;
+			cached.erase(cached.begin() + i);
+			SetParameters(desc, target.texture);
+			reuses++;
+			break;
+		}
+	}
+
+	if (target.texture == 0)
+	{
+		target.texture = CreateTexture(desc);
+		allocations++;
+	}
+
+	used.push_back(target);
+	return target.texture;
+}
+
+/**
+* Give the texture back. It is kept for a while for the next texture with the same description,
+* the oldest kept one is deleted when there are too many of them.
+* @param texture - Handler of the texture taken from the pool (0 is ignored)
+*/
+void RenderTargetPool::Release(GLuint texture)
+{
+	if (texture == 0)
+	{
+		return;
+	}
+
+	for (int i = 0; i < (int)used.size(); i++)
+	{
+		if (used[i].texture == texture)
+		{
+			cached.push_back(used[i]);
+			used.erase(used.begin() + i);
+			break;
+		}
+	}
+
+	while ((int)cached.size() > cacheSize)
+	{
+		GLState::DeleteTextures(1, &cached[0].texture);
+		cached.erase(cached.begin());
+		evictions++;
+	}
+}
+
+/**
+* Add counters of textures created, reused and deleted so far, and of memory kept, to the profiler.
+*/
+void RenderTargetPool::ReportStatistics()
+{
+	GLfloat cachedMegabytes = 0;
+	for (int i = 0; i < (int)cached.size(); i++)
+	{
+		cachedMegabytes += GetMegabytes(cached[i].desc);
+	}
+
+	Profiler * localProfiler = ENGINE->profiler;
+	localProfiler->AddCounter("Targets created", allocations);
+	localProfiler->AddCounter("Targets reused", reuses);
+	localProfiler->AddCounter("Targets deleted", evictions);
+	localProfiler->AddCounter("Targets kept MB", cachedMegabytes);
+}
+
+/**
+* Print textures created, reused and deleted since the previous time it was printed.
+*/
+void RenderTargetPool::PrintEvents()
+{
+	printf("Render target pool: %d created, %d reused, %d deleted, %d in use, %d kept\n",
+		allocations - printedAllocations, reuses - printedReuses, evictions - printedEvictions,
+		(int)used.size(), (int)cached.size());
+	printedAllocations = allocations;
+	printedReuses = reuses;
+	printedEvictions = evictions;
+}
+
+/**
+* Create the texture with the description.
+* @param desc - Description of the texture
+* @return Handler of the texture
+*/
+GLuint RenderTargetPool::CreateTexture(const FrameGraphTextureDesc &desc)
+{
+	GLenum target = (desc.layers > 0) ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+	GLenum format = IsDepthFormat(desc.internalFormat) ? GL_DEPTH_COMPONENT : GL_RGBA;
+	GLuint texture;
+	glGenTextures(1, &texture);
+	GLState::BindTexture(target, texture);
+	if (desc.layers > 0)
+	{
+		glTexImage3D(target, 0, desc.internalFormat, desc.width, desc.height, desc.layers, 0, format, GL_FLOAT, NULL);
+	}
+	else
+	{
+		// Every mip level is half of the previous one, down to 1x1 when all of them are needed.
+		int width = desc.width;
+		int height = desc.height;
+		for (int level = 0; level < desc.levels; level++)
+		{
+			glTexImage2D(target, level, desc.internalFormat, width, height, 0, format, GL_FLOAT, NULL);
+			width = glm::max(1, width / 2);
+			height = glm::max(1, height / 2);
+		}
+	}
+	GLState::BindTexture(target, 0);
+	SetParameters(desc, texture);
+	return texture;
+}
+
+/**
+* Set sampling parameters of the texture from its description.
+* @param desc		- Description of the texture
+* @param texture	- Handler of the texture
+*/
+void RenderTargetPool::SetParameters(const FrameGraphTextureDesc &desc, GLuint texture)
+{
+	// Linearly filtered mip levels are blended too (nearest ones are read level by level).
+	GLenum target = (desc.layers > 0) ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+	GLenum minFilter = (desc.levels > 1 && desc.filter == GL_LINEAR) ? GL_LINEAR_MIPMAP_LINEAR : desc.filter;
+	GLState::BindTexture(target, texture);
+	glTexParameteri(target, GL_TEXTURE_MIN_FILTER, minFilter);
+	glTexParameteri(target, GL_TEXTURE_MAG_FILTER, desc.filter);
+	glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, desc.levels - 1);
+	GLState::BindTexture(target, 0);
+}
+
+/**
+* Check if two descriptions make the same texture, so one texture can serve both.
+* @param a - Description of the first texture
+* @param b - Description of the second texture
+* @return True when they are the same
+*/
+bool RenderTargetPool::SameTexture(const FrameGraphTextureDesc &a, const FrameGraphTextureDesc &b)
+{
+	return a.internalFormat == b.internalFormat && a.width == b.width && a.height == b.height &&
+		a.layers == b.layers && a.levels == b.levels && a.filter == b.filter;
+}
+
+/**
+* Check if the format is a depth format.
+* @param internalFormat - Format of the texture
+* @return True for the depth format
+*/
+bool RenderTargetPool::IsDepthFormat(GLenum internalFormat)
+{
+	return internalFormat == GL_DEPTH_COMPONENT16 || internalFormat == GL_DEPTH_COMPONENT24 ||
+		internalFormat == GL_DEPTH_COMPONENT32 || internalFormat == GL_DEPTH_COMPONENT32F;
+}
+
+/**
+* Get the size of one texel of the format.
+* @param internalFormat - Format of the texture
+* @return Size in bytes
+*/
+int RenderTargetPool::GetTexelBytes(GLenum internalFormat)
+{
+	switch (internalFormat)
+	{
+	case GL_R8:
+		return 1;
+	case GL_R16:
+	case GL_R16F:
+	case GL_RG8:
+	case GL_DEPTH_COMPONENT16:
+		return 2;
+	case GL_RGBA16F:
+	case GL_RG32F:
+		return 8;
+	case GL_RGBA32F:
+		return 16;
+	default:
+		return 4;
+	}
+}
+
+/**
+* Get the memory taken by the texture with the description (with all its layers and mip levels).
+* @param desc - Description of the texture
+* @return Memory in megabytes
+*/
+GLfloat RenderTargetPool::GetMegabytes(const FrameGraphTextureDesc &desc)
+{
+	GLfloat texels = 0;
+	int width = desc.width;
+	int height = desc.height;
+	for (int level = 0; level < desc.levels; level++)
+	{
+		texels += (GLfloat)width * height;
+		width = glm::max(1, width / 2);
+		height = glm::max(1, height / 2);
+	}
+	return texels * glm::max(1, desc.layers) * desc.bytes / (1024 * 1024);
+}
+
+/**
+* Simple destructor clearing all data.
+*/
+RenderTargetPool::~RenderTargetPool()
+{
+	for (int i = 0; i < (int)used.size(); i++)
+	{
+		GLState::DeleteTextures(1, &used[i].texture);
+	}
+	for (int i = 0; i < (int)cached.size(); i++)
+	{
+		GLState::DeleteTextures(1, &cached[i].texture);
+	}
+}
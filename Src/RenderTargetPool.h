@@ -0,0 +1,117 @@
+#pragma once
+
+/**
+* LightShafts example.
+*
+* This is a render target pool class. Textures of render targets are taken
+* from it and given back to it, and it keeps a few of the given back ones
+* for a while, so targets made again with the same size and format (when
+* the window is resized back and forth or the render scale goes up and down)
+* don't have to be created by the driver again.
+*
+* (c) 2014 Damian Nowakowski
+*/
+
+#include <vector>
+#include "Engine.h"
+#include "FrameGraph.h"
+
+class RenderTargetPool
+{
+public:
+	/**
+	* Simple constructor and destructor
+	*/
+	RenderTargetPool();
+	~RenderTargetPool();
+
+	/**
+	* Take the texture with the description. The most recently given back one with the same
+	* description is taken when there is any, otherwise a new one is created.
+	* @param desc - Description of the texture
+	* @return Handler of the texture
+	*/
+	GLuint Acquire(const FrameGraphTextureDesc &desc);
+
+	/**
+	* Give the texture back. It is kept for a while for the next texture with the same description,
+	* the oldest kept one is deleted when there are too many of them.
+	* @param texture - Handler of the texture taken from the pool (0 is ignored)
+	*/
+	void Release(GLuint texture);
+
+	/**
+	* Add counters of textures created, reused and deleted so far, and of memory kept, to the profiler.
+	*/
+	void ReportStatistics();
+
+	/**
+	* Print textures created, reused and deleted since the previous time it was printed.
+	*/
+	void PrintEvents();
+
+	/**
+	* Check if two descriptions make the same texture, so one texture can serve both.
+	* @param a - Description of the first texture
+	* @param b - Description of the second texture
+	* @return True when they are the same
+	*/
+	static bool SameTexture(const FrameGraphTextureDesc &a, const FrameGraphTextureDesc &b);
+
+	/**
+	* Check if the format is a depth format.
+	* @param internalFormat - Format of the texture
+	* @return True for the depth format
+	*/
+	static bool IsDepthFormat(GLenum internalFormat);
+
+	/**
+	* Get the size of one texel of the format.
+	* @param internalFormat - Format of the texture
+	* @return Size in bytes
+	*/
+	static int GetTexelBytes(GLenum internalFormat);
+
+	/**
+	* Get the memory taken by the texture with the description (with all its layers and mip levels).
+	* @param desc - Description of the texture
+	* @return Memory in megabytes
+	*/
+	static GLfloat GetMegabytes(const FrameGraphTextureDesc &desc);
+
+private:
+
+	/**
+	* Texture created by the pool.
+	*/
+	struct Target
+	{
+		FrameGraphTextureDesc desc;	///< Description of the texture
+		GLuint texture;				///< Handler of the texture
+	};
+
+	/**
+	* Create the texture with the description.
+	* @param desc - Description of the texture
+	* @return Handler of the texture
+	*/
+	GLuint CreateTexture(const FrameGraphTextureDesc &desc);
+
+	/**
+	* Set sampling parameters of the texture from its description.
+	* @param desc		- Description of the texture
+	* @param texture	- Handler of the texture
+	*/
+	void SetParameters(const FrameGraphTextureDesc &desc, GLuint texture);
+
+	std::vector<Target> used;		///< Textures taken from the pool
+	std::vector<Target> cached;		///< Textures given back, the most recently given back last
+	int cacheSize;					///< Most textures kept after they are given back
+
+	int allocations;				///< Number of textures created
+	int reuses;						///< Number of textures taken again from the kept ones
+	int evictions;					///< Number of kept textures deleted to make room for others
+	int printedAllocations;			///< Number of textures created when events were printed
+	int printedReuses;				///< Number of textures taken again when events were printed
+	int printedEvictions;			///< Number of kept textures deleted when events were printed
+};
@@ -0,0 +1,222 @@
+/**
+* LightShafts example.
+*
+* This is a dynamic resolution governor class. It measures how long the GPU
+* takes for every frame (reading results a few frames late, without waiting)
+* and scales render targets of the scene and light shafts down when the frame
+* doesn't fit in the budget, and back up when it fits with a margin.
+*
+* (c) 2014 Damian Nowakowski
+*/
+
+#include <cmath>
+#include "ResolutionGovernor.h"
+#include "Scene.h"
+#include "Camera.h"
+#include "Profiler.h"
+#include "glm/glm.hpp"
+
+/**
+* Simple constructor with initialization
+*/
+ResolutionGovernor::ResolutionGovernor()
+{
+	// Remember the configuration reader so we can use it in the future.
+	INIReader * localINIReader = ENGINE->config;
+
+	enabled		= localINIReader->GetBoolean("Render", "DynamicResolution", false);
+	budget		= glm::max(0.1, localINIReader->GetReal("Render", "FrameBudget", 14.0));
+	raiseMargin	= glm::clamp(localINIReader->GetReal("Render", "RaiseMargin", 0.85), 0.1, 1.0);
+	holdFrames	= glm::max(1, (int)localINIReader->GetInteger("Render", "HoldFrames", 30));
+	minScale	= glm::clamp((GLfloat)localINIReader->GetReal("Render", "MinRenderScale", 0.5), 0.1f, 1.0f);
+	scaleStep	= glm::clamp((GLfloat)localINIReader->GetReal("Render", "RenderScaleStep", 0.1), 0.01f, 1.0f);
+
+	scale		= 1;
+	next		= 0;
+	measuring	= false;
+	firstFrame	= 0;
+	overFrames	= 0;
+	underFrames	= 0;
+	for (int i = 0; i < GOVERNOR_QUERIES; i++)
+	{
+		issued[i] = false;
+	}
+
+	// With the profiler frames are measured by its sections, so the governor needs no queries.
+	if (enabled && ENGINE->profiler->enabled == false)
+	{
+		glGenQueries(GOVERNOR_QUERIES, queries);
+	}
+}
+
+/**
+* Run this before the frame is drawn. It starts measuring the GPU time of the frame.
+*/
+void ResolutionGovernor::BeginFrame()
+{
+	if (enabled == false || ENGINE->profiler->enabled)
+	{
+		return;
+	}
+
+	/// The frame is measured with the elapsed time, not with timestamps, because timestamps would count
+	/// also the time the GPU waits for the CPU (e.g. while it reads results back), and a frame that is not
+	/// slow on the GPU would lower the scale. When all queries are still waiting the frame is not measured
+	/// at all, so the CPU never waits for them.
+	measuring = false;
+	if (issued[next] == true)
+	{
+		GLuint available = 0;
+		glGetQueryObjectuiv(queries[next], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available == 0)
+		{
+			return;
+		}
+		ReadQuery(next);
+	}
+	glBeginQuery(GL_TIME_ELAPSED, queries[next]);
+	measuring = true;
+}
+
+/**
+* Run this after the frame is drawn. It stops measuring the frame, collects finished
+* measurements and changes the render scale when they say so.
+*/
+void ResolutionGovernor::EndFrame()
+{
+	if (enabled == false)
+	{
+		return;
+	}
+
+	/// The profiler measures passes with elapsed time queries and those can't be nested, so with the profiler
+	/// the frame time is the sum of its passes instead (the profiler reads them a few frames late too).
+	if (ENGINE->profiler->enabled)
+	{
+		int number;
+		double time;
+		while (ENGINE->profiler->TakeFrameTime(number, time))
+		{
+			// Frames drawn with the previous scale don't count.
+			if (number >= firstFrame)
+			{
+				JudgeFrame(time);
+			}
+		}
+		ENGINE->profiler->AddCounter("Render scale", scale);
+		return;
+	}
+
+	if (measuring)
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		issued[next] = true;
+		next = (next + 1) % GOVERNOR_QUERIES;
+		measuring = false;
+	}
+
+	// Collect results that are already available from the oldest one, so frames are judged in order.
+	for (int i = 0; i < GOVERNOR_QUERIES; i++)
+	{
+		int index = (next + i) % GOVERNOR_QUERIES;
+		if (issued[index] == false)
+		{
+			continue;
+		}
+		GLuint available = 0;
+		glGetQueryObjectuiv(queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available == 0)
+		{
+			break;
+		}
+		ReadQuery(index);
+	}
+}
+
+/**
+* Read the GPU time of the frame measured with the query and decide about the render scale.
+* @param index - Index of the query
+*/
+void ResolutionGovernor::ReadQuery(int index)
+{
+	GLuint64 elapsed = 0;
+	glGetQueryObjectui64v(queries[index], GL_QUERY_RESULT, &elapsed);
+	issued[index] = false;
+
+	// Scale changes forget the queries, so a read query is always of the current scale.
+	JudgeFrame(elapsed / 1000000.0);
+}
+
+/**
+* Decide about the render scale from the GPU time of the frame.
+* @param time - GPU time of the frame in milliseconds
+*/
+void ResolutionGovernor::JudgeFrame(double time)
+{
+	ENGINE->profiler->AddCounter("GPU frame ms", time);
+
+	/// The scale changes only when frames agree for some time: it goes down when they are over the budget,
+	/// and up when they would still fit in its part at the higher scale. The time grows with the area of
+	/// render targets, so it is predicted with the square of scales. Between these two nothing changes.
+	GLfloat higherScale = glm::min(1.0f, scale + scaleStep);
+	double higherTime = time * (higherScale / scale) * (higherScale / scale);
+	if (time > budget)
+	{
+		overFrames++;
+		underFrames = 0;
+	}
+	else if (scale < 1 && higherTime < budget * raiseMargin)
+	{
+		underFrames++;
+		overFrames = 0;
+	}
+	else
+	{
+		overFrames = 0;
+		underFrames = 0;
+	}
+
+	/// Going down jumps at once (in whole steps) to the scale that should fit in the budget, so slow
+	/// machines don't miss frames for many steps. Going up takes one step at a time.
+	if (overFrames >= holdFrames && scale > minScale)
+	{
+		GLfloat fitScale = scale * (GLfloat)sqrt(budget / time);
+		GLfloat steps = glm::max(1.0f, (GLfloat)ceil((scale - fitScale) / scaleStep - 0.001f));
+		SetScale(glm::max(minScale, scale - steps * scaleStep));
+	}
+	else if (underFrames >= holdFrames)
+	{
+		SetScale(higherScale);
+	}
+}
+
+/**
+* Change the render scale and forget measurements of the previous one.
+* @param newScale - the new render scale
+*/
+void ResolutionGovernor::SetScale(GLfloat newScale)
+{
+	scale = newScale;
+	ENGINE->scene->SetRenderScale(scale);
+	printf("Render scale %.2f (%dx%d)\n", scale, ENGINE->scene->camera->renderWidth, ENGINE->scene->camera->renderHeight);
+
+	// Frames still measured were drawn with the previous scale, so they don't count.
+	for (int i = 0; i < GOVERNOR_QUERIES; i++)
+	{
+		issued[i] = false;
+	}
+	firstFrame = ENGINE->profiler->GetFrameNumber() + 1;
+	overFrames = 0;
+	underFrames = 0;
+}
+
+/**
+* Simple destructor clearing all data.
+*/
+ResolutionGovernor::~ResolutionGovernor()
+{
+	if (enabled && ENGINE->profiler->enabled == false)
+	{
+		glDeleteQueries(GOVERNOR_QUERIES, queries);
+	}
+}
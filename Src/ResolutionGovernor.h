@@ -0,0 +1,75 @@
+#pragma once
+
+/**
+* LightShafts example.
+*
+* This is a dynamic resolution governor class. It measures how long the GPU
+* takes for every frame (reading results a few frames late, without waiting)
+* and scales render targets of the scene and light shafts down when the frame
+* doesn't fit in the budget, and back up when it fits with a margin.
+*
+* (c) 2014 Damian Nowakowski
+*/
+
+#include "Engine.h"
+
+// Define the number of queries the governor cycles through, so results are read a few frames late without waiting
+#define GOVERNOR_QUERIES 4
+
+class ResolutionGovernor
+{
+public:
+	/**
+	* Simple constructor and destructor
+	*/
+	ResolutionGovernor();
+	~ResolutionGovernor();
+
+	bool enabled;	///< True when the render scale follows the GPU frame time
+
+	/**
+	* Run this before the frame is drawn. It starts measuring the GPU time of the frame.
+	*/
+	void BeginFrame();
+
+	/**
+	* Run this after the frame is drawn. It stops measuring the frame, collects finished
+	* measurements and changes the render scale when they say so.
+	*/
+	void EndFrame();
+
+private:
+
+	/**
+	* Read the GPU time of the frame measured with the query and decide about the render scale.
+	* @param index - Index of the query
+	*/
+	void ReadQuery(int index);
+
+	/**
+	* Decide about the render scale from the GPU time of the frame.
+	* @param time - GPU time of the frame in milliseconds
+	*/
+	void JudgeFrame(double time);
+
+	/**
+	* Change the render scale and forget measurements of the previous one.
+	* @param newScale - the new render scale
+	*/
+	void SetScale(GLfloat newScale);
+
+	GLuint queries[GOVERNOR_QUERIES];		///< Elapsed time queries of frames (without the profiler)
+	bool issued[GOVERNOR_QUERIES];			///< True when the query waits for its result
+	int next;								///< Index of the query used next time
+	bool measuring;							///< True when the query of the current frame was begun
+	int firstFrame;							///< Number of the first profiler frame drawn with the current scale
+
+	double budget;				///< GPU time of the frame to hold in milliseconds
+	double raiseMargin;			///< Part of the budget the frame has to fit in at the higher scale before it is raised
+	int holdFrames;				///< Number of frames in a row that have to agree before the scale changes
+	GLfloat minScale;			///< The lowest render scale
+	GLfloat scaleStep;			///< Step of the render scale
+	GLfloat scale;				///< Current render scale
+	int overFrames;				///< Number of frames in a row over the budget
+	int underFrames;			///< Number of frames in a row fitting in the budget at the higher scale
+};
@@ -14,6 +14,28 @@
 #include "Model.h"
 #include "Shaders.h"
 #include "LightShafts.h"
+#include "Profiler.h"
+#include "FrameGraph.h"
+#include "RenderTargetPool.h"
+#include "glm/gtc/constants.hpp"
+
+/**
+* Pass of the frame graph drawing a part of the scene with the member function of the scene.
+*/
+class ScenePass : public FrameGraphPass
+{
+public:
+	ScenePass(Scene * scene, void (Scene::*draw)()) : scene(scene), draw(draw) {}
+
+	void Execute(FrameGraph *)
+	{
+		(scene->*draw)();
+	}
+
+private:
+	Scene * scene;			///< The scene drawing the pass
+	void (Scene::*draw)();	///< Member function of the scene drawing the pass
+};
 
 /**
 * Initialize the scene
@@ -35,8 +57,136 @@ void Scene::Init()
 	camera		= new Camera();
 	light		= new Light();
 	model		= new Model();
+
+	/// The benchmark scene has more lights making light shafts. They are spread on a spiral around
+	/// the configured light, in the same distance from the camera, and every one has a different color.
+	lights.push_back(light);
+	int lightsCount = localINIReader->GetInteger("Benchmark", "Lights", 1);
+	for (int i = 1; i < lightsCount; i++)
+	{
+		GLfloat angle = i * glm::pi<GLfloat>() * (3.0f - sqrt(5.0f));
+		GLfloat radius = 1.5f * sqrt((GLfloat)i);
+		glm::vec3 position = light->position + glm::vec3(radius * cos(angle), radius * sin(angle), 0);
+
+		// Go around the hue circle by the golden ratio, so neighbour lights have different colors.
+		GLfloat hue = fmod(i * 0.618034f, 1.0f) * 6.0f;
+		glm::vec3 color = glm::clamp(glm::vec3(fabs(hue - 3.0f) - 1.0f, 2.0f - fabs(hue - 2.0f), 2.0f - fabs(hue - 4.0f)), 0.0f, 1.0f);
+		lights.push_back(new Light(position, glm::mix(glm::vec3(1), color, 0.6f)));
+	}
+
+	// Light shafts are created last, they need to know the lights and take render targets from the pool.
+	targetPool = new RenderTargetPool();
 	lightShafts = new LightShafts();
+	resizePending = false;
+
+	/// With the depth pre-pass only the nearest fragments of the model are shaded. Fragment shader invocations
+	/// are counted when pipeline statistics are supported, otherwise samples passing the depth test are
+	/// (only they are shaded when the early depth test is used).
+	depthPrepass = localINIReader->GetBoolean("Benchmark", "DepthPrepass", false);
+	fragmentsQuery = GLEW_ARB_pipeline_statistics_query ? GL_FRAGMENT_SHADER_INVOCATIONS_ARB : GL_SAMPLES_PASSED;
 
+	// Passes of the frame go through the frame graph.
+	BuildFrameGraph();
+	if (ENGINE->profiler->enabled)
+	{
+		frameGraph->Dump();
+		targetPool->PrintEvents();
+	}
+}
+
+/**
+* Scale render targets of the scene and light shafts relative to the final image.
+* @param scale - the new render scale in (0,1]
+*/
+void Scene::SetRenderScale(GLfloat scale)
+{
+	camera->SetRenderScale(scale);
+	resizePending = true;
+}
+
+/**
+* Change the size of the final image (after the window was resized). Render targets of the scene
+* and light shafts are made again before the next frame is drawn.
+* @param width - the new width of the final image
+* @param height - the new height of the final image
+*/
+void Scene::SetOutputSize(int width, int height)
+{
+	camera->SetOutputSize(width, height);
+	resizePending = true;
+}
+
+/**
+* Make render targets of light shafts and the frame graph again for the current render size of the camera.
+*/
+void Scene::ResizeTargets()
+{
+	/// The frame graph gives its transients back to the pool when it is deleted and light shafts give
+	/// theirs back before taking new ones, so targets of a size used a moment ago are taken from the pool.
+	delete frameGraph;
+	lightShafts->Resize();
+	BuildFrameGraph();
+	resizePending = false;
+	if (ENGINE->profiler->enabled)
+	{
+		targetPool->PrintEvents();
+	}
+}
+
+/**
+* Declare all passes of the frame in a new frame graph and compile it.
+*/
+void Scene::BuildFrameGraph()
+{
+	/// Passes of the frame only declare what they read and render to. The frame graph orders them, creates
+	/// transient targets, and binds and clears frame buffers. The occlusion is added before the normal scene,
+	/// so its depth is not needed any more when the scene is drawn and both can share one texture.
+	frameGraph = new FrameGraph(targetPool);
+	lightShafts->DeclareTargets(frameGraph, this);
+	int sceneColor		= lightShafts->sceneColorTarget;
+	int sceneDepth		= lightShafts->sceneDepthTarget;
+	int occlusion		= lightShafts->occlusionTarget;
+	int occlusionDepth	= lightShafts->occlusionDepthTarget;
+	int pass;
+	if (lightShafts->singlePass)
+	{
+		// The normal scene and the occlusion at once (the model shader writes them in this order)
+		pass = frameGraph->AddPass("Single pass", new ScenePass(this, &Scene::DrawSinglePass));
+		frameGraph->Attach(pass, sceneColor);
+		frameGraph->Attach(pass, occlusion);
+		frameGraph->Attach(pass, sceneDepth);
+	}
+	else
+	{
+		if (lightShafts->depthOcclusion == false)
+		{
+			pass = frameGraph->AddPass("Occlusion", new ScenePass(this, &Scene::DrawOcclusionPass));
+			frameGraph->Attach(pass, occlusion);
+			frameGraph->Attach(pass, occlusionDepth);
+		}
+
+		pass = frameGraph->AddPass("Normal", new ScenePass(this, &Scene::DrawNormalPass));
+		frameGraph->Attach(pass, sceneColor);
+		frameGraph->Attach(pass, sceneDepth);
+
+		// The occlusion from depth writes every texel, so it is not cleared.
+		if (lightShafts->depthOcclusion)
+		{
+			pass = frameGraph->AddPass("Occlusion", new ScenePass(this, &Scene::DrawDepthOcclusionPass));
+			frameGraph->Read(pass, sceneDepth);
+			frameGraph->Attach(pass, occlusion, false);
+		}
+	}
+
+	pass = frameGraph->AddPass("Shafts", new ScenePass(this, &Scene::DrawShaftsPass));
+	frameGraph->Read(pass, sceneColor);
+	frameGraph->Read(pass, sceneDepth);
+	frameGraph->Read(pass, occlusion);
+	frameGraph->Write(pass, lightShafts->screenTarget);
+	frameGraph->SetOutput(lightShafts->screenTarget);
+
+	frameGraph->Compile();
+	lightShafts->AcquireTargets(frameGraph);
 }
 
 /**
@@ -71,18 +221,86 @@ void Scene::OnRun(double deltaTime)
 */
 void Scene::OnDraw()
 {
-	// Draw the normal scene to the texture
-	// (no need for rendering point light twice)
-	lightShafts->StartDrawingNormal(this);
+	/// The window sends many sizes while it is dragged, so render targets are made again only once
+	/// before the frame, for the last of them.
+	if (resizePending)
+	{
+		ResizeTargets();
+	}
+
+	// All passes go in the order compiled by the frame graph, each measured by the profiler.
+	frameGraph->Execute();
+	targetPool->ReportStatistics();
+}
+
+/**
+* Draw the shaded model of the normal scene, after its depth when the pre-pass is on.
+*/
+void Scene::DrawNormalModel()
+{
+	if (depthPrepass)
+	{
+		// Draw only the depth first, then shade only fragments with the same depth without writing it again.
+		model->DrawDepth(camera);
+		glDepthFunc(GL_LEQUAL);
+		glDepthMask(GL_FALSE);
+	}
+
+	ENGINE->profiler->BeginStatistic("Shaded fragments", fragmentsQuery);
 	model->Draw(camera, light, false);
+	ENGINE->profiler->EndStatistic();
+
+	if (depthPrepass)
+	{
+		glDepthMask(GL_TRUE);
+		glDepthFunc(GL_LESS);
+	}
+}
 
-	// Draw the occlusion to the texture
-	lightShafts->StartDrawingOcclusion(this);
-	light->DrawTheMarker();
+/**
+* Pass of the frame graph drawing the occlusion scene and light markers
+* (markers go last, so the occlusion query knows if the model hides them).
+*/
+void Scene::DrawOcclusionPass()
+{
 	model->Draw(camera, light, true);
+	lightShafts->DrawLightMarkers(lights);
+}
 
-	// Compose these two textures and draw the final lightshafts scene
-	lightShafts->DrawLightShafts(camera, light);
+/**
+* Pass of the frame graph drawing the normal scene (no need for rendering point light twice).
+*/
+void Scene::DrawNormalPass()
+{
+	DrawNormalModel();
+}
+
+/**
+* Pass of the frame graph drawing the normal scene and the occlusion at once
+* (markers go last and only to the occlusion).
+*/
+void Scene::DrawSinglePass()
+{
+	DrawNormalModel();
+	lightShafts->DrawLightMarkers(lights);
+}
+
+/**
+* Pass of the frame graph making the occlusion from the depth of the normal scene
+* (without drawing the model nor markers again).
+*/
+void Scene::DrawDepthOcclusionPass()
+{
+	lightShafts->DrawDepthOcclusion(this);
+}
+
+/**
+* Pass of the frame graph composing the normal scene and the occlusion
+* and drawing the final lightshafts scene.
+*/
+void Scene::DrawShaftsPass()
+{
+	lightShafts->DrawLightShafts(camera, lights);
 }
 
 /**
@@ -91,7 +309,12 @@ void Scene::OnDraw()
 Scene::~Scene()
 {
 	delete camera;
-	delete light;
+	for (int i = 0; i < (int)lights.size(); i++)
+	{
+		delete lights[i];
+	}
 	delete model;
+	delete frameGraph;
 	delete lightShafts;
+	delete targetPool;
 }
\ No newline at end of file
@@ -9,6 +9,7 @@
 * (c) 2014 Damian Nowakowski
 */
 
+#include <vector>
 #include "Engine.h"
 
 // Predefine classes for visibility
@@ -16,6 +17,8 @@ class Camera;
 class Light;
 class Model;
 class LightShafts;
+class FrameGraph;
+class RenderTargetPool;
 
 class Scene
 {
@@ -28,9 +31,15 @@ public:
 	float			bgColor[4];		///< Background color used in clearing scene (RGBA).
 
 	Camera*			camera;			///< Handler of the camera in the scene.
-	Light*			light;			///< Handler of the point light in the scene.
+	Light*			light;			///< Handler of the point light in the scene (controlled and lighting the model).
+	std::vector<Light*> lights;		///< All point lights making light shafts (the first one is the light above).
 	Model*			model;			///< Handler of the model in the scene.
 	LightShafts*	lightShafts;	///< Handler of the lightshafts effect used in the scene.
+	FrameGraph*		frameGraph;		///< Handler of the frame graph with all passes of the scene.
+	RenderTargetPool* targetPool;	///< Handler of the pool render targets of the scene and light shafts are taken from.
+
+	bool			depthPrepass;	///< True when the depth of the model is drawn before it is shaded
+	GLenum			fragmentsQuery;	///< Target of the query counting shaded fragments of the normal scene
 
 	/**
 	* Initialize the scene
@@ -50,5 +59,65 @@ public:
 	*/
 	void OnDraw();
 
-	
+	/**
+	* Scale render targets of the scene and light shafts relative to the final image.
+	* They are made again before the next frame is drawn.
+	* @param scale - the new render scale in (0,1]
+	*/
+	void SetRenderScale(GLfloat scale);
+
+	/**
+	* Change the size of the final image (after the window was resized). Render targets of the scene
+	* and light shafts are made again before the next frame is drawn.
+	* @param width - the new width of the final image
+	* @param height - the new height of the final image
+	*/
+	void SetOutputSize(int width, int height);
+
+private:
+	/**
+	* Make render targets of light shafts and the frame graph again for the current render size of the camera.
+	*/
+	void ResizeTargets();
+
+	bool			resizePending;	///< True when render targets don't have the current render size of the camera
+
+	/**
+	* Declare all passes of the frame in a new frame graph and compile it.
+	*/
+	void BuildFrameGraph();
+
+	/**
+	* Draw the shaded model of the normal scene, after its depth when the pre-pass is on.
+	*/
+	void DrawNormalModel();
+
+	/**
+	* Pass of the frame graph drawing the occlusion scene and light markers
+	* (markers go last, so the occlusion query knows if the model hides them).
+	*/
+	void DrawOcclusionPass();
+
+	/**
+	* Pass of the frame graph drawing the normal scene (no need for rendering point light twice).
+	*/
+	void DrawNormalPass();
+
+	/**
+	* Pass of the frame graph drawing the normal scene and the occlusion at once
+	* (markers go last and only to the occlusion).
+	*/
+	void DrawSinglePass();
+
+	/**
+	* Pass of the frame graph making the occlusion from the depth of the normal scene
+	* (without drawing the model nor markers again).
+	*/
+	void DrawDepthOcclusionPass();
+
+	/**
+	* Pass of the frame graph composing the normal scene and the occlusion
+	* and drawing the final lightshafts scene.
+	*/
+	void DrawShaftsPass();
 };
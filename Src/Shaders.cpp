@@ -11,6 +11,7 @@
 #include <stdlib.h>
 #include <iostream>
 #include <fstream>
+#include <iterator>
 #include "shaders.h"
 
 // Use this macro when something go bad. The program will pause
@@ -25,10 +26,11 @@
 *					 (if not initialized this function will create program under this handler)
 * @param typ		- Type of shader, can be: GL_VERTEX_SHADER, GL_FRAGMENT_SHADER or GL_GEOMETRY_SHADER
 * @param path		- Path to the shader file
+* @param defines	- Lines of #define directives injected after the #version of the shader
 */
-void Shaders::AttachShader(GLuint &program, GLenum type, const char *path)
+void Shaders::AttachShader(GLuint &program, GLenum type, const char *path, const std::string &defines)
 {
-	GLuint shader = LoadShader(type, path);
+	GLuint shader = LoadShader(type, path, defines);
 
 	// If the program doesn't exist create a new one
 	if (glIsProgram(program) == false)
@@ -85,36 +87,32 @@ void Shaders::DeleteShaders(GLuint program)
 
 /**
 * Load shader from the file
-* @param type - Type of shader, can be: GL_VERTEX_SHADER, GL_FRAGMENT_SHADER or GL_GEOMETRY_SHADER
-* @param path - Path to the shader file
+* @param type		- Type of shader, can be: GL_VERTEX_SHADER, GL_FRAGMENT_SHADER or GL_GEOMETRY_SHADER
+* @param path		- Path to the shader file
+* @param defines	- Lines of #define directives injected after the #version of the shader
 * @returns the id of the created shader
 */
-GLuint Shaders::LoadShader(GLenum type, const char *path)
+GLuint Shaders::LoadShader(GLenum type, const char *path, const std::string &defines)
 {
-	/// Read the shader from file to buffer
-	std::ifstream file;
-	file.open(path, std::ios::binary);
-	if (file.is_open() == false || file.bad() == true)
+	/// Read the shader from file with all included files
+	std::string source = ReadSource(path);
+
+	/// Nothing but comments can be before the #version, so defines go right after its line
+	/// (or at the beginning when the shader doesn't have it).
+	if (defines.empty() == false)
 	{
-		printf("Can't open the shader file: %s\n", path);
-		FAIL_GRACEFULLY
+		size_t version = source.find("#version");
+		size_t position = (version == std::string::npos) ? 0 : source.find('\n', version);
+		position = (position == std::string::npos) ? source.size() : position + 1;
+		source.insert(position, defines);
 	}
-	file.seekg(0, std::ios::end);
-	int fileLength = (int)(file.tellg());
-	file.seekg(0, std::ios::beg);
-	GLchar* sourceBuffer = new GLchar[(fileLength + 1) * sizeof(GLchar)];
-	file.read(sourceBuffer, fileLength);
-	sourceBuffer[fileLength] = '\0';
-	file.close();
 
 	// Create shader of asked type.
 	GLuint shader = glCreateShader(type);
 
 	// Load the source to the shader
-	glShaderSource(shader, 1, const_cast<const GLchar**>(&sourceBuffer), NULL);
-
-	// Clean up the buffer
-	delete[] sourceBuffer;
+	const GLchar *sourceBuffer = source.c_str();
+	glShaderSource(shader, 1, &sourceBuffer, NULL);
 
 	// Now compile the shader
 	glCompileShader(shader);
@@ -126,6 +124,53 @@ GLuint Shaders::LoadShader(GLenum type, const char *path)
 	return shader;
 }
 
+/**
+* Read the shader source from the file, replacing every #include "file" line
+* with the source of that file (its path is relative to the including file).
+* @param path	- Path to the shader file
+* @param depth	- How many files include this one (to stop the endless including)
+* @returns the source of the shader
+*/
+std::string Shaders::ReadSource(const std::string &path, int depth)
+{
+	if (depth > 16)
+	{
+		printf("Too deep includes of the shader file: %s\n", path.c_str());
+		FAIL_GRACEFULLY
+	}
+
+	/// Read the shader from file to the string
+	std::ifstream file;
+	file.open(path.c_str(), std::ios::binary);
+	if (file.is_open() == false || file.bad() == true)
+	{
+		printf("Can't open the shader file: %s\n", path.c_str());
+		FAIL_GRACEFULLY
+	}
+	std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	file.close();
+
+	/// Replace include lines with sources of included files, found next to this one.
+	std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+	size_t include = source.find("#include");
+	while (include != std::string::npos)
+	{
+		size_t lineEnd = source.find('\n', include);
+		size_t nameStart = source.find('"', include);
+		size_t nameEnd = (nameStart == std::string::npos) ? nameStart : source.find('"', nameStart + 1);
+		if (nameEnd == std::string::npos || (lineEnd != std::string::npos && nameEnd > lineEnd))
+		{
+			printf("Wrong #include in the shader file: %s\n", path.c_str());
+			FAIL_GRACEFULLY
+		}
+		std::string included = ReadSource(directory + source.substr(nameStart + 1, nameEnd - nameStart - 1), depth + 1);
+		source.replace(include, nameEnd + 1 - include, included);
+		include = source.find("#include", include + included.size());
+	}
+
+	return source;
+}
+
 /**
 * Validate the shader. Use right after the glCompileShader.
 * Function reads the last shader compilation error. When there was an error
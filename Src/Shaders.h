@@ -9,6 +9,7 @@
 
 #pragma once
 
+#include <string>
 #include <GL/glew.h>
 
 class Shaders
@@ -20,8 +21,9 @@ public:
 	*					 (if not initialized this function will create program under this handler)
 	* @param typ		- Type of shader, can be: GL_VERTEX_SHADER, GL_FRAGMENT_SHADER or GL_GEOMETRY_SHADER
 	* @param path		- Path to the shader file
+	* @param defines	- Lines of #define directives injected after the #version of the shader
 	*/											  
-	static void AttachShader(GLuint &program, GLenum type, const char *path);
+	static void AttachShader(GLuint &program, GLenum type, const char *path, const std::string &defines = "");
 
 	/**
 	* Link the attached shaders into the program
@@ -39,10 +41,20 @@ private:
 	/**
 	* Load shader from the file
 	* @param type - Type of shader, can be: GL_VERTEX_SHADER, GL_FRAGMENT_SHADER or GL_GEOMETRY_SHADER
-	* @param path - Path to the shader file
+	* @param path		- Path to the shader file
+	* @param defines	- Lines of #define directives injected after the #version of the shader
 	* @returns the id of the created shader
 	*/
-	static GLuint LoadShader(GLenum type, const char *path);
+	static GLuint LoadShader(GLenum type, const char *path, const std::string &defines);
+
+	/**
+	* Read the shader source from the file, replacing every #include "file" line
+	* with the source of that file (its path is relative to the including file).
+	* @param path	- Path to the shader file
+	* @param depth	- How many files include this one (to stop the endless including)
+	* @returns the source of the shader
+	*/
+	static std::string ReadSource(const std::string &path, int depth = 0);
 
 	/**
 	* Validate the shader. Use right after the glCompileShader. 
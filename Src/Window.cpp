@@ -16,6 +16,7 @@ Window::Window()
 {
 	// Just make sure that the handler is pointing to null
 	glfwWindow = NULL;
+	resizable = false;
 }
 
 /**
@@ -45,8 +46,10 @@ bool Window::Init()
 	// Remember the configuration reader so we can use it in the future.
 	INIReader * localINIReader = ENGINE->config;
 
-	// Set the hint that window will not be resizable (it is easier for us)
-	glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);
+	/// Check in configuration ini file if the window can be resized. Render targets follow
+	/// the size of the resizable window, otherwise they have the size of the camera.
+	resizable = localINIReader->GetBoolean("Window", "Resizable", false);
+	glfwWindowHint(GLFW_RESIZABLE, resizable ? GL_TRUE : GL_FALSE);
 		
 	/// Check in configuration ini file if application will be in fullscreen
 	/// If yes remember the handler to the current monitor. If no, then the handler
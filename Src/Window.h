@@ -21,6 +21,7 @@ public:
 	~Window();
 
 	GLFWwindow* glfwWindow;	///< Handler of the glfw window (needed for most glfw function)
+	bool resizable;			///< True when the window can be resized (and render targets follow it)
 
 	/**
 	* Initialize the window.